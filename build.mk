@@ -1,7 +1,7 @@
 LIBUTILS_CONFIG=$(PWD)/lib/libutils.conf
 LIBUTILS=$(BUILD)/lib/libutils.a
 
-LDFLAGS=$(LIBUTILS)
+LDFLAGS=$(LIBUTILS) -pthread
 
 BUILD_DIRS=$(BUILD) \
 		   $(BUILD)/include \
@@ -14,9 +14,16 @@ MKSUBDIRS=$(addprefix $(OBJ_DIR)/, $(SUBDIRS))
 SRCS=$(shell cd $(PWD)/src && find * -type f -name '*.c')
 OBJS=$(addprefix $(OBJ_DIR)/nanorl_, $(SRCS:.c=.o))
 
+TEST_SRCS=$(shell cd $(PWD)/test && find * -type f -name '*.c')
+TEST_BINS=$(addprefix $(BUILD)/bin/nrl_test_, $(TEST_SRCS:.c=))
+
 .PHONY: build
 build: $(BUILD_DIRS) headers $(TARGET_STATIC) $(TARGET_SHARED) $(TARGET_EXAMPLE)
 
+.PHONY: check
+check: $(BUILD_DIRS) headers $(TEST_BINS)
+	for test in $(TEST_BINS); do $$test || exit 1; done
+
 # Templates
 define make_build_dir
 $(1):
@@ -50,10 +57,13 @@ $(TARGET_STATIC_IM): $(BUILD) $(OBJS)
 $(TARGET_STATIC): $(TARGET_STATIC_IM) $(LIBUTILS)
 	./repack.sh $(OBJ_DIR) $@ $^
 
-$(TARGET_EXAMPLE): LDFLAGS=$(TARGET_STATIC)
+$(TARGET_EXAMPLE): LDFLAGS=$(TARGET_STATIC) -pthread
 $(TARGET_EXAMPLE): example/nrl_example.c $(TARGET_STATIC)
 	$(CC) $(CFLAGS) -o $@ $< $(LDFLAGS)
 
+$(BUILD)/bin/nrl_test_%: $(PWD)/test/%.c $(TARGET_STATIC)
+	$(CC) $(CFLAGS) -o $@ $< $(TARGET_STATIC) -pthread
+
 .PHONY: $(LIBUTILS)
 $(LIBUTILS): lib/c-utils
 	$(MAKE) -C $< $(TASK) \
@@ -7,6 +7,11 @@
 #include <nanorl/nanorl.h>
 
 const char *err_to_string(nrl_error err);
+bool highlight_digits(const char *line,
+					  uint32_t length,
+					  uint32_t offset,
+					  uint64_t *state,
+					  nrl_span *span);
 
 int main(void) {
 	printf("nanorl version: %s\n\n", nrl_version);
@@ -44,6 +49,33 @@ int main(void) {
 	printf("You typed: %s\n\n", input);
 	free(input);
 
+	// Horizontal scrolling
+	config.prompt = "scrolling line: ";
+	config.preload = NULL;
+	config.layout_mode = NRL_LAYOUT_SCROLL;
+	input = nanorl(&config, &error);
+	printf("%s\n", err_to_string(error));
+	printf("You typed: %s\n\n", input);
+	free(input);
+
+	// Highlighting
+	config.prompt = "type some numbers: ";
+	config.layout_mode = NRL_LAYOUT_WRAP;
+	config.highlighter = &highlight_digits;
+	input = nanorl(&config, &error);
+	printf("%s\n", err_to_string(error));
+	printf("You typed: %s\n\n", input);
+	free(input);
+
+	// Timeout
+	config.prompt = "you have 5 seconds: ";
+	config.highlighter = NULL;
+	config.timeout_ms = 5000;
+	input = nanorl(&config, &error);
+	printf("%s\n", err_to_string(error));
+	printf("You typed: %s\n\n", input);
+	free(input);
+
 	return 0;
 }
 
@@ -59,7 +91,36 @@ const char *err_to_string(nrl_error err) {
 		return "EOF reached";
 	case NRL_ERROR_INTERRUPT:
 		return "Interrupted!";
+	case NRL_ERROR_CANCEL:
+		return "Cancelled";
+	case NRL_ERROR_TIMEOUT:
+		return "Timed out";
 	}
 
 	return NULL;
 }
+
+bool highlight_digits(const char *line,
+					  uint32_t length,
+					  uint32_t offset,
+					  uint64_t *state,
+					  nrl_span *span) {
+	(void)state;
+
+	// Find next number
+	while (offset < length && (line[offset] < '0' || line[offset] > '9')) {
+		offset++;
+	}
+	if (offset == length) {
+		return false;
+	}
+
+	span->start = offset;
+	while (offset < length && line[offset] >= '0' && line[offset] <= '9') {
+		offset++;
+	}
+	span->length = offset - span->start;
+	span->style = "1;34";
+
+	return true;
+}
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @var nrl_version
@@ -35,6 +36,22 @@ typedef enum {
 	NRL_ECHO_OBSCURED,
 } nrl_echo_mode;
 
+/**
+ * @enum nrl_layout_mode
+ * Line layout mode.
+ *
+ * @var nrl_layout_mode::NRL_LAYOUT_WRAP
+ * Line is printed in full and wraps at the terminal edge.
+ *
+ * @var nrl_layout_mode::NRL_LAYOUT_SCROLL
+ * Line stays on a single row and scrolls horizontally; only the visible part
+ * around the cursor is printed.
+ */
+typedef enum {
+	NRL_LAYOUT_WRAP = 0,
+	NRL_LAYOUT_SCROLL = 1,
+} nrl_layout_mode;
+
 /**
  * @enum nrl_error
  * Error codes for nanorl library functions.
@@ -53,6 +70,12 @@ typedef enum {
  *
  * @var nrl_error::NRL_ERROR_ARG
  * Invalid configuration; data not returned.
+ *
+ * @var nrl_error::NRL_ERROR_CANCEL
+ * Cancelled through @ref nrl_config::cancel; data not returned.
+ *
+ * @var nrl_error::NRL_ERROR_TIMEOUT
+ * @ref nrl_config::timeout_ms passed; data not returned.
  */
 typedef enum {
 	NRL_ERROR_OK = 0,
@@ -61,8 +84,120 @@ typedef enum {
 	NRL_ERROR_EOF = -3,
 
 	NRL_ERROR_ARG = -4,
+
+	NRL_ERROR_CANCEL = -5,
+	NRL_ERROR_TIMEOUT = -6,
 } nrl_error;
 
+/**
+ * @def NRL_KEY_CTRL
+ * Key identifier for a control character (e.g. NRL_KEY_CTRL('A')).
+ */
+#define NRL_KEY_CTRL(c) ((c) & 0x1f)
+
+/**
+ * @def NRL_KEY_DEL
+ * Key identifier for the DEL character, sent by backspace on most terminals.
+ */
+#define NRL_KEY_DEL 0x7f
+
+/**
+ * @enum nrl_key
+ * Key identifiers for special keys. Control characters use
+ * @ref NRL_KEY_CTRL.
+ */
+typedef enum {
+	NRL_KEY_LEFT = 0x20,
+	NRL_KEY_RIGHT,
+	NRL_KEY_BACKSPACE,
+	NRL_KEY_HOME,
+	NRL_KEY_END,
+	NRL_KEY_DELETE,
+	NRL_KEY_CTRL_LEFT,
+	NRL_KEY_CTRL_RIGHT,
+	NRL_KEY_ALT_LEFT,
+	NRL_KEY_ALT_RIGHT,
+	NRL_KEY_CTRL_DELETE,
+} nrl_key;
+
+/**
+ * @struct nrl_line
+ * Line being edited, passed to key bindings.
+ */
+typedef struct nrl_line nrl_line;
+
+/**
+ * @brief Key binding function.
+ *
+ * @param[in,out] line - Line being edited.
+ */
+typedef void (*nrl_binding)(nrl_line *line);
+
+/**
+ * @struct nrl_span
+ * Styled part of the line.
+ *
+ * @var nrl_span::start
+ * Index of the first character in the span.
+ *
+ * @var nrl_span::length
+ * Character count.
+ *
+ * @var nrl_span::style
+ * SGR parameters applied to the span (e.g. "1;34").
+ */
+typedef struct {
+	uint32_t start;
+	uint32_t length;
+	const char *style;
+} nrl_span;
+
+/**
+ * @brief Syntax highlighting hook.
+ *
+ * Lexes the line from @p offset and stores the next styled span. The hook is
+ * resumed from earlier results after edits, so lexing from @p offset must only
+ * depend on @p state and the text at or after @p offset.
+ *
+ * @param[in] line - Line data (not null-terminated).
+ * @param[in] length - Line length.
+ * @param[in] offset - Position to continue lexing from.
+ * @param[in,out] state - Lexer state at @p offset, 0 at line start.
+ * Should be updated to the state after the returned span.
+ * @param[out] span - Next span; must not start before @p offset.
+ * @return true - Span stored. \n
+ *         false - No more spans in the line.
+ */
+typedef bool (*nrl_highlighter)(const char *line,
+								uint32_t length,
+								uint32_t offset,
+								uint64_t *state,
+								nrl_span *span);
+
+/**
+ * @brief Input completeness hook for multi-line input.
+ *
+ * Called with each row as it is entered. Rows are passed in order, so the
+ * check can resume from @p state instead of parsing earlier rows again.
+ *
+ * @param[in] row - Row just entered, ending with a newline (not
+ * null-terminated).
+ * @param[in] length - Row length.
+ * @param[in,out] state - Parser state after the earlier rows, 0 at the start
+ * of the input. Should be updated to the state after @p row.
+ * @return true - Input is complete. \n
+ *         false - Input continues on the next row.
+ */
+typedef bool (*nrl_continuation)(const char *row,
+								 uint32_t length,
+								 uint64_t *state);
+
+/**
+ * @struct nrl_cancel
+ * Cancellation handle for blocked nanorl calls.
+ */
+typedef struct nrl_cancel nrl_cancel;
+
 /**
  * @struct nrl_config
  * Configuration options.
@@ -86,6 +221,41 @@ typedef enum {
  *
  * @var nrl_config::echo_mode
  * Echo behavior mode.
+ *
+ * @var nrl_config::layout_mode
+ * Line layout mode.
+ *
+ * @var nrl_config::scroll_step
+ * @info Can be 0.
+ * Amount of characters to scroll by when the cursor leaves the visible part of
+ * the line in @ref NRL_LAYOUT_SCROLL mode. Zero selects half the visible width.
+ *
+ * @var nrl_config::highlighter
+ * @info Can be NULL.
+ * Syntax highlighting hook. Not used with @ref NRL_ECHO_OBSCURED.
+ *
+ * @var nrl_config::suggest
+ * Show the most recent matching history entry after the line. Only used with
+ * @ref NRL_ECHO_ON.
+ *
+ * @var nrl_config::continuation
+ * @info Can be NULL.
+ * Hook deciding whether Enter ends the input. While it reports incomplete
+ * input, Enter starts a new row, and the rows are returned joined by
+ * newlines.
+ *
+ * @var nrl_config::continuation_prompt
+ * @info Can be NULL.
+ * Prompt printed before each row after the first.
+ *
+ * @var nrl_config::cancel
+ * @info Can be NULL.
+ * Handle that stops the call with @ref NRL_ERROR_CANCEL when triggered.
+ *
+ * @var nrl_config::timeout_ms
+ * @info Can be 0.
+ * Time limit for the call in milliseconds, after which it stops with
+ * @ref NRL_ERROR_TIMEOUT. Zero waits for input indefinitely.
  */
 typedef struct {
 	int read_file;
@@ -96,11 +266,138 @@ typedef struct {
 
 	bool assume_smkx;
 	nrl_echo_mode echo_mode;
+
+	nrl_layout_mode layout_mode;
+	uint32_t scroll_step;
+
+	nrl_highlighter highlighter;
+	bool suggest;
+
+	nrl_continuation continuation;
+	const char *continuation_prompt;
+
+	nrl_cancel *cancel;
+	uint32_t timeout_ms;
 } nrl_config;
 
+/**
+ * @def NRL_STATS_LATENCY_BUCKETS
+ * Amount of buckets in the latency histogram.
+ */
+#define NRL_STATS_LATENCY_BUCKETS 24
+
+/**
+ * @struct nrl_stats
+ * Runtime statistics. Only collected if the library is built with STATS=1.
+ *
+ * @var nrl_stats::read_calls
+ * Read system calls.
+ *
+ * @var nrl_stats::read_bytes
+ * Bytes read.
+ *
+ * @var nrl_stats::write_calls
+ * Write system calls.
+ *
+ * @var nrl_stats::write_bytes
+ * Bytes written.
+ *
+ * @var nrl_stats::dfa_states
+ * Escape sequence DFA states visited.
+ *
+ * @var nrl_stats::dfa_matches
+ * Escape sequences matched.
+ *
+ * @var nrl_stats::renders
+ * Renders performed.
+ *
+ * @var nrl_stats::renders_skipped
+ * Renders skipped, because more input was available.
+ *
+ * @var nrl_stats::render_bytes
+ * Bytes output by all renders.
+ *
+ * @var nrl_stats::render_bytes_max
+ * Most bytes output by a single render.
+ *
+ * @var nrl_stats::line_reallocs
+ * Line buffer reallocations which moved the line.
+ *
+ * @var nrl_stats::latency
+ * Histogram of time from input being read to output being flushed. Bucket i
+ * counts latencies below 2^i microseconds; the last bucket counts the rest.
+ */
+typedef struct {
+	uint64_t read_calls;
+	uint64_t read_bytes;
+	uint64_t write_calls;
+	uint64_t write_bytes;
+
+	uint64_t dfa_states;
+	uint64_t dfa_matches;
+
+	uint64_t renders;
+	uint64_t renders_skipped;
+	uint64_t render_bytes;
+	uint64_t render_bytes_max;
+
+	uint64_t line_reallocs;
+
+	uint64_t latency[NRL_STATS_LATENCY_BUCKETS];
+} nrl_stats;
+
+/**
+ * @struct nrl_replay_report
+ * Results of a replayed recording.
+ *
+ * @var nrl_replay_report::lines
+ * Lines returned.
+ *
+ * @var nrl_replay_report::chunks
+ * Input chunks replayed.
+ *
+ * @var nrl_replay_report::input_bytes
+ * Input bytes replayed.
+ *
+ * @var nrl_replay_report::renders
+ * Renders performed.
+ *
+ * @var nrl_replay_report::output_bytes
+ * Bytes written to the output.
+ *
+ * @var nrl_replay_report::render_bytes_max
+ * Most bytes output by a single render.
+ *
+ * @var nrl_replay_report::screen_mismatches
+ * Renders after which the emulated screen did not show the line. Only
+ * counted by test builds ('make check'); 0 otherwise.
+ *
+ * @var nrl_replay_report::cpu_time_ns
+ * Process CPU time spent, in nanoseconds.
+ *
+ * @var nrl_replay_report::recorded_time_ns
+ * Time from the start of the recording to the last chunk, in nanoseconds.
+ */
+typedef struct {
+	uint64_t lines;
+	uint64_t chunks;
+	uint64_t input_bytes;
+
+	uint64_t renders;
+	uint64_t output_bytes;
+	uint64_t render_bytes_max;
+	uint64_t screen_mismatches;
+
+	uint64_t cpu_time_ns;
+	uint64_t recorded_time_ns;
+} nrl_replay_report;
+
 /**
  * @brief Start nanorl.
  *
+ * If the input file is not a terminal, the line is read as is, without a
+ * prompt, echo or editing.
+ *
  * @param[in] config - nanorl configuration.
  * @param[out] error - Error code buffer (can be NULL).
  * @return Inputted line; NULL on some errors.
@@ -121,3 +418,240 @@ char *nrl_readline(const char *prompt);
  * @return Default config.
  */
 nrl_config nrl_default_config(void);
+
+/**
+ * @brief Add a line to history.
+ *
+ * @param[in] line - Line to add; empty lines are ignored.
+ * @note With a history file, the line is appended to the file and loaded
+ * back along with entries of other processes before this returns. While the
+ * file is still loading, or another process compacts it, the line is kept in
+ * memory and appended by a later call.
+ */
+void nrl_history_add(const char *line);
+
+/**
+ * @brief Remove all history entries.
+ *
+ * @note The history file is not changed.
+ */
+void nrl_history_clear(void);
+
+/**
+ * @brief Share history with other processes through a file.
+ *
+ * Entries in the file are loaded on a separate thread, so the first prompt
+ * is not delayed; until the load finishes, suggestions come from the entries
+ * loaded so far. Each nanorl call then loads entries added since by other
+ * processes. Processes append without locking; the file is compacted by
+ * replacing it once it grows past HISTORY_FILE_SIZE.
+ *
+ * @param[in] path - History file; created if missing.
+ * @return Whether the file was opened.
+ */
+bool nrl_history_open(const char *path);
+
+/**
+ * @brief Stop sharing history; entries in memory are kept.
+ */
+void nrl_history_close(void);
+
+/**
+ * @brief Set up the terminal once for multiple nanorl calls.
+ *
+ * Raw mode, signal handlers and keypad mode stay active until
+ * @ref nrl_session_end, so each nanorl call only prints the prompt and edits
+ * the line.
+ *
+ * @param[in] config - nanorl configuration; read_file, echo_file and
+ * assume_smkx are used for the session.
+ * @return @ref NRL_ERROR_OK on success; @ref NRL_ERROR_ARG if a session is
+ * already active or config is invalid; @ref NRL_ERROR_SYSTEM if setup failed.
+ * @note nanorl calls during a session must use the same files.
+ */
+nrl_error nrl_session_begin(const nrl_config *config);
+
+/**
+ * @brief Restore the terminal after @ref nrl_session_begin.
+ *
+ * @return @ref NRL_ERROR_OK on success; @ref NRL_ERROR_SYSTEM if restore
+ * failed.
+ */
+nrl_error nrl_session_end(void);
+
+/**
+ * @brief Print a message above the line from any thread.
+ *
+ * The message is queued and printed by the nanorl call waiting for input, or
+ * by the next one. Messages queued together are printed with a single redraw
+ * of the prompt and the line.
+ *
+ * @param[in] text - Message; a newline is added if missing.
+ * @return Whether the message was queued.
+ * @note Only printed by interactive nanorl calls.
+ */
+bool nrl_print_async(const char *text);
+
+/**
+ * @brief Create a cancellation handle.
+ *
+ * @return New handle; NULL on failure (check errno).
+ */
+nrl_cancel *nrl_cancel_create(void);
+
+/**
+ * @brief Cancel nanorl calls waiting with the handle.
+ *
+ * The handle stays triggered, so calls started later are cancelled too, until
+ * @ref nrl_cancel_reset.
+ *
+ * @param[in] cancel - Cancellation handle.
+ * @note Safe to call from other threads and signal handlers.
+ */
+void nrl_cancel_trigger(nrl_cancel *cancel);
+
+/**
+ * @brief Clear a triggered handle, so it can be used again.
+ *
+ * @param[in] cancel - Cancellation handle.
+ */
+void nrl_cancel_reset(nrl_cancel *cancel);
+
+/**
+ * @brief Free a cancellation handle.
+ *
+ * @param[in] cancel - Cancellation handle (can be NULL); must not be in use.
+ */
+void nrl_cancel_free(nrl_cancel *cancel);
+
+/**
+ * @brief Bind a function to a key.
+ *
+ * @param[in] key - Control character, @ref NRL_KEY_DEL or @ref nrl_key.
+ * @param[in] binding - Function to call; NULL to ignore the key.
+ * @return true - Key bound. \n
+ *         false - Key can't be bound.
+ * @note Newline and EOT (Ctrl-D) always end input and can't be bound.
+ */
+bool nrl_bind_key(uint32_t key, nrl_binding binding);
+
+/**
+ * @brief Get line contents.
+ *
+ * @param[in] line - Line being edited.
+ * @param[out] length - Line length.
+ * @return Line data; not null-terminated.
+ */
+const char *nrl_line_data(const nrl_line *line, uint32_t *length);
+
+/**
+ * @brief Get cursor position.
+ *
+ * @param[in] line - Line being edited.
+ * @return Cursor position.
+ */
+uint32_t nrl_line_cursor(const nrl_line *line);
+
+/**
+ * @brief Move cursor.
+ *
+ * @param[in,out] line - Line being edited.
+ * @param[in] cursor - New position; clamped to the line length.
+ */
+void nrl_line_set_cursor(nrl_line *line, uint32_t cursor);
+
+/**
+ * @brief Insert text at the cursor.
+ *
+ * @param[in,out] line - Line being edited.
+ * @param[in] text - Text to insert.
+ * @param[in] length - Text length.
+ */
+void nrl_line_insert(nrl_line *line, const char *text, uint32_t length);
+
+/**
+ * @brief Erase a range of characters.
+ *
+ * @param[in,out] line - Line being edited.
+ * @param[in] from - First character to erase.
+ * @param[in] to - Character to stop at (exclusive).
+ */
+void nrl_line_erase(nrl_line *line, uint32_t from, uint32_t to);
+
+/**
+ * @brief Start reading lines from a file in bulk, without editing.
+ *
+ * @param[in] fd - File descriptor to read from.
+ * @return Whether the file was opened.
+ * @note Reading starts with input buffered by earlier nanorl calls, then
+ * continues from the file position. Regular files are memory mapped.
+ */
+bool nrl_lines_open(int fd);
+
+/**
+ * @brief Get next line from the file opened with @ref nrl_lines_open.
+ *
+ * @param[out] line - Line data; not null-terminated, without the newline.
+ * Valid until the next call.
+ * @param[out] length - Line length.
+ * @return @ref NRL_ERROR_OK on success; @ref NRL_ERROR_EOF when there are no
+ * more lines; other errors on failure.
+ */
+nrl_error nrl_lines_next(const char **line, uint32_t *length);
+
+/**
+ * @brief Stop reading lines and free buffers.
+ *
+ * @note File descriptor is not closed. For memory mapped files, its position
+ * is moved past the returned lines.
+ */
+void nrl_lines_close(void);
+
+/**
+ * @brief Get runtime statistics collected since the last reset.
+ *
+ * @param[out] stats - Statistics buffer; zeroed if statistics are disabled.
+ */
+void nrl_stats_get(nrl_stats *stats);
+
+/**
+ * @brief Reset runtime statistics.
+ */
+void nrl_stats_reset(void);
+
+/**
+ * @brief Start recording all input read by nanorl.
+ *
+ * Each chunk returned by a read is written with a timestamp, so the session
+ * can be reproduced with @ref nrl_replay.
+ *
+ * @param[in] fd - File descriptor to write the recording to.
+ * @return Whether recording started.
+ * @note File descriptor is not closed by @ref nrl_record_stop.
+ */
+bool nrl_record_start(int fd);
+
+/**
+ * @brief Stop recording input.
+ */
+void nrl_record_stop(void);
+
+/**
+ * @brief Replay a recording made with @ref nrl_record_start.
+ *
+ * Recorded chunks are fed through the normal input path, in the same sizes,
+ * until the recording ends. No terminal is used: output is counted for an 80
+ * column screen, using the bundled xterm capabilities where available (the
+ * default), and $TERM otherwise. Test builds also check an emulated screen
+ * against the line after every render.
+ *
+ * @param[in] fd - File descriptor to read the recording from.
+ * @param[in] config - nanorl configuration used for each line; files are
+ * only used as identifiers.
+ * @param[out] report - Replay results.
+ * @return @ref NRL_ERROR_OK on success; @ref NRL_ERROR_ARG if the recording
+ * is invalid or recording is active; other errors from nanorl.
+ */
+nrl_error nrl_replay(int fd,
+					 const nrl_config *config,
+					 nrl_replay_report *report);
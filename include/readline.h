@@ -11,3 +11,5 @@
 #include "nanorl.h"
 
 #define readline nrl_readline
+#define add_history nrl_history_add
+#define clear_history nrl_history_clear
@@ -0,0 +1,96 @@
+/**
+ * @cond internal
+ * @file cancel.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Cancellation handles.
+ *
+ * A handle is a self-pipe: triggering writes a byte, which keeps the read end
+ * readable until the handle is reset.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "cancel.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "nanorl.h"
+
+#define PIPE_READ 0
+#define PIPE_WRITE 1
+
+struct nrl_cancel {
+	int pipe[2];
+};
+
+static bool set_flags(int fd);
+
+nrl_cancel *nrl_cancel_create(void) {
+	nrl_cancel *cancel = malloc(sizeof(nrl_cancel));
+	if (cancel == NULL) {
+		return NULL;
+	}
+
+	if (pipe(cancel->pipe) < 0) {
+		free(cancel);
+		return NULL;
+	}
+
+	// Neither end may block the caller
+	if (!set_flags(cancel->pipe[PIPE_READ])
+		|| !set_flags(cancel->pipe[PIPE_WRITE])) {
+		nrl_cancel_free(cancel);
+		return NULL;
+	}
+
+	return cancel;
+}
+
+void nrl_cancel_trigger(nrl_cancel *cancel) {
+	// Failure means the pipe is full, so already triggered
+	char byte = 0;
+	ssize_t res = write(cancel->pipe[PIPE_WRITE], &byte, 1);
+	(void)res;
+}
+
+void nrl_cancel_reset(nrl_cancel *cancel) {
+	char drain[64];
+	while (read(cancel->pipe[PIPE_READ], drain, sizeof(drain)) > 0) {
+	}
+}
+
+void nrl_cancel_free(nrl_cancel *cancel) {
+	if (cancel == NULL) {
+		return;
+	}
+
+	close(cancel->pipe[PIPE_READ]);
+	close(cancel->pipe[PIPE_WRITE]);
+	free(cancel);
+}
+
+int nrl_cancel_fd(const nrl_cancel *cancel) {
+	return (cancel != NULL) ? cancel->pipe[PIPE_READ] : -1;
+}
+
+/**
+ * @brief Make a pipe end non-blocking and close it on exec.
+ *
+ * @param[in] fd - File descriptor.
+ * @return Whether the flags were set.
+ */
+static bool set_flags(int fd) {
+	int status = fcntl(fd, F_GETFL);
+	if (status < 0 || fcntl(fd, F_SETFL, status | O_NONBLOCK) < 0) {
+		return false;
+	}
+
+	int descriptor = fcntl(fd, F_GETFD);
+	return descriptor >= 0 && fcntl(fd, F_SETFD, descriptor | FD_CLOEXEC) >= 0;
+}
+
+// @endcond
@@ -0,0 +1,23 @@
+/**
+ * @cond internal
+ * @file cancel.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Cancellation handles.
+ */
+#pragma once
+
+#include "nanorl.h"
+
+/**
+ * @brief Get the file descriptor to wait on.
+ *
+ * @param[in] cancel - Cancellation handle (can be NULL).
+ * @return File descriptor that becomes readable when triggered; -1 if
+ * cancel is NULL.
+ */
+int nrl_cancel_fd(const nrl_cancel *cancel);
+
+// @endcond
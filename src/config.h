@@ -29,6 +29,30 @@
 #define DFA_DEBUG 0
 #endif // DFA_DEBUG
 
+#ifndef HISTORY_INDEX_DEPTH
+#define HISTORY_INDEX_DEPTH 64
+#endif // HISTORY_INDEX_DEPTH
+
+#ifndef HISTORY_FILE_SIZE
+#define HISTORY_FILE_SIZE (1 << 20)
+#endif // HISTORY_FILE_SIZE
+
+#ifndef HISTORY_RECORD_MAX
+#define HISTORY_RECORD_MAX (1 << 24)
+#endif // HISTORY_RECORD_MAX
+
+#ifndef STATS
+#define STATS 0
+#endif // STATS
+
+#ifndef PROBES
+#define PROBES 0
+#endif // PROBES
+
+#ifndef SCREEN_CHECK
+#define SCREEN_CHECK 0
+#endif // SCREEN_CHECK
+
 #ifndef FASTLOAD
 #define FASTLOAD 1
 #endif // FASTLOAD
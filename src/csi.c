@@ -0,0 +1,232 @@
+/**
+ * @cond internal
+ * @file csi.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Generic control sequence parser.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "csi.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "probes.h"
+#include "terminfo.h"
+
+/**
+ * @def CSI_MAX_LENGTH
+ * Longest sequence accepted, including the introducer.
+ */
+#define CSI_MAX_LENGTH 32
+
+/**
+ * @def CSI_MAX_PARAMS
+ * Parameters kept for decoding; the rest are ignored.
+ */
+#define CSI_MAX_PARAMS 3
+
+/**
+ * @def CSI_MAX_VALUE
+ * Parameter values are clamped to this.
+ */
+#define CSI_MAX_VALUE 0xffff
+
+// xterm modifier bits, after subtracting one from the parameter
+#define MOD_ALT 0x2
+#define MOD_CTRL 0x4
+
+static void decode(char intro,
+				   char final,
+				   const uint32_t *params,
+				   csi_key *key);
+static void decode_modified(uint32_t mods,
+							terminfo_input plain,
+							terminfo_input ctrl,
+							terminfo_input alt,
+							csi_key *key);
+static void decode_char(uint32_t code, uint32_t mods, csi_key *key);
+
+bool nrl_csi_parse(char (*next_char)(), csi_key *key) {
+	if (next_char() != '\033') {
+		return false;
+	}
+
+	char intro = next_char();
+	if (intro != '[' && intro != 'O') {
+		return false;
+	}
+
+	uint32_t params[CSI_MAX_PARAMS] = { 0 };
+	uint32_t index = 0;
+	bool sub_param = false;
+	bool plain = true;
+
+	for (uint32_t length = 2; length < CSI_MAX_LENGTH; length++) {
+		char c = next_char();
+
+		// Final byte
+		if (c >= 0x40 && c <= 0x7e) {
+			key->type = CSI_KEY_NONE;
+			if (plain) {
+				decode(intro, c, params, key);
+			}
+
+			PROBE1(csi__accept, c);
+			return true;
+		}
+
+		if (c >= '0' && c <= '9') {
+			if (index < CSI_MAX_PARAMS && !sub_param) {
+				uint32_t value = params[index] * 10 + (c - '0');
+				params[index] = (value < CSI_MAX_VALUE) ? value : CSI_MAX_VALUE;
+			}
+		} else if (c == ';') {
+			index++;
+			sub_param = false;
+		} else if (c == ':') {
+			// Only the main value of a parameter is used
+			sub_param = true;
+		} else if (c >= 0x20 && c <= 0x3f) {
+			// Private parameters and intermediates: not a key
+			plain = false;
+		} else {
+			break;
+		}
+	}
+
+	PROBE1(csi__reject, intro);
+	return false;
+}
+
+/**
+ * @brief Interpret a complete sequence.
+ *
+ * @param[in] intro - '[' for CSI, 'O' for SS3.
+ * @param[in] final - Final character.
+ * @param[in] params - Numeric parameters; missing ones are zero.
+ * @param[out] key - Buffer for the result.
+ */
+static void decode(char intro,
+				   char final,
+				   const uint32_t *params,
+				   csi_key *key) {
+	uint32_t mods = (params[1] > 0) ? params[1] - 1 : 0;
+
+	switch (final) {
+	case 'C':
+		decode_modified(mods, TII_KEY_RIGHT, TII_KEY_CTRL_RIGHT,
+						TII_KEY_ALT_RIGHT, key);
+		return;
+	case 'D':
+		decode_modified(mods, TII_KEY_LEFT, TII_KEY_CTRL_LEFT,
+						TII_KEY_ALT_LEFT, key);
+		return;
+	case 'H':
+		decode_modified(mods, TII_KEY_HOME, TII_KEY_HOME, TII_KEY_HOME, key);
+		return;
+	case 'F':
+		decode_modified(mods, TII_KEY_END, TII_KEY_END, TII_KEY_END, key);
+		return;
+	default:
+		break;
+	}
+
+	// SS3 only has the keys above
+	if (intro != '[') {
+		return;
+	}
+
+	if (final == 'u') {
+		decode_char(params[0], mods, key);
+		return;
+	}
+	if (final != '~') {
+		return;
+	}
+
+	switch (params[0]) {
+	case 1:
+	case 7:
+		decode_modified(mods, TII_KEY_HOME, TII_KEY_HOME, TII_KEY_HOME, key);
+		break;
+	case 3:
+		decode_modified(mods, TII_KEY_DELETE, TII_KEY_CTRL_DELETE,
+						TII_KEY_DELETE, key);
+		break;
+	case 4:
+	case 8:
+		decode_modified(mods, TII_KEY_END, TII_KEY_END, TII_KEY_END, key);
+		break;
+	case 27:
+		// modifyOtherKeys: CSI 27 ; modifiers ; code ~
+		decode_char(params[2], mods, key);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Pick the key variant for the modifiers held.
+ *
+ * @param[in] mods - Modifier bits.
+ * @param[in] plain - Key without modifiers.
+ * @param[in] ctrl - Key with control held.
+ * @param[in] alt - Key with alt held.
+ * @param[out] key - Buffer for the result.
+ * @note Control takes precedence over alt; shift is ignored.
+ */
+static void decode_modified(uint32_t mods,
+							terminfo_input plain,
+							terminfo_input ctrl,
+							terminfo_input alt,
+							csi_key *key) {
+	key->type = CSI_KEY_ESCAPE;
+
+	if (mods & MOD_CTRL) {
+		key->escape = ctrl;
+	} else if (mods & MOD_ALT) {
+		key->escape = alt;
+	} else {
+		key->escape = plain;
+	}
+}
+
+/**
+ * @brief Interpret a character key with modifiers.
+ *
+ * @param[in] code - Unicode code point.
+ * @param[in] mods - Modifier bits.
+ * @param[out] key - Buffer for the result.
+ * @note Only ASCII is supported; alt combinations are dropped.
+ */
+static void decode_char(uint32_t code, uint32_t mods, csi_key *key) {
+	if (code == 0 || code >= 0x80 || (mods & MOD_ALT)) {
+		return;
+	}
+
+	if (code == 0x7f || code == '\b') {
+		key->type = CSI_KEY_ESCAPE;
+		key->escape = TII_KEY_BACKSPACE;
+		return;
+	}
+
+	// Enter is submitted as a newline in raw mode
+	char ascii = (code == '\r') ? '\n' : (char)code;
+	if ((mods & MOD_CTRL) && code >= '@' && code < 0x7f) {
+		ascii = code & 0x1f;
+	}
+
+	// Escape key alone does nothing
+	if (ascii == '\033') {
+		return;
+	}
+
+	key->type = CSI_KEY_CHAR;
+	key->ascii = ascii;
+}
+
+// @endcond
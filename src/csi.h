@@ -0,0 +1,68 @@
+/**
+ * @cond internal
+ * @file csi.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Generic control sequence parser.
+ */
+#pragma once
+
+#include <stdbool.h>
+
+#include "terminfo.h"
+
+/**
+ * @enum csi_key_type
+ * Meaning of a parsed control sequence.
+ *
+ * @var csi_key_type::CSI_KEY_NONE
+ * Sequence is not a supported key; it should be dropped.
+ *
+ * @var csi_key_type::CSI_KEY_ESCAPE
+ * Sequence is a key with a terminfo input identifier.
+ *
+ * @var csi_key_type::CSI_KEY_CHAR
+ * Sequence encodes a character.
+ */
+typedef enum {
+	CSI_KEY_NONE,
+	CSI_KEY_ESCAPE,
+	CSI_KEY_CHAR,
+} csi_key_type;
+
+/**
+ * @struct csi_key
+ * Parsed control sequence.
+ *
+ * @var csi_key::type
+ * Meaning of the sequence.
+ *
+ * @var csi_key::escape
+ * Input identifier. Used with @ref CSI_KEY_ESCAPE.
+ *
+ * @var csi_key::ascii
+ * Character. Used with @ref CSI_KEY_CHAR.
+ */
+typedef struct {
+	csi_key_type type;
+	terminfo_input escape;
+	char ascii;
+} csi_key;
+
+/**
+ * @brief Parse a CSI or SS3 control sequence (ECMA-48).
+ *
+ * Keys with xterm modifier parameters (CSI 1;5D), CSI u and CSI 27;m;c~
+ * are decoded; other well-formed sequences are reported as
+ * @ref CSI_KEY_NONE.
+ *
+ * @param[in] next_char - Next character acquisition function.
+ * @param[out] key - Buffer for the parsed sequence.
+ * @return true - Sequence consumed. \n
+ *         false - Input is not a well-formed sequence.
+ */
+bool nrl_csi_parse(char (*next_char)(), csi_key *key);
+
+// @endcond
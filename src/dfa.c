@@ -13,10 +13,10 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "probes.h"
+#include "stats.h"
 #include "terminfo.h"
 
-typedef struct dfa_node dfa_node;
-
 /**
  * @union dfa_value
  *
@@ -49,42 +49,55 @@ struct dfa_node {
 	uint32_t children_count;
 };
 
-/**
- * @var root
- * Root DFA element. Its edge value does not matter.
- */
-static dfa_node root = {
-	.edge = '\0',
-	.value.children = NULL,
-	.children_count = 0,
-};
+static void dfa_insert(dfa_node *root,
+					   terminfo_seq sequence,
+					   terminfo_input accept_value);
+static void free_children(dfa_node *node);
 
-static void dfa_insert(const char *sequence, terminfo_input accept_value);
+dfa_node *nrl_dfa_build(const terminfo_seq *inputs) {
+	// Edge value of the root does not matter
+	dfa_node *root = calloc(1, sizeof(dfa_node));
+	if (root == NULL) {
+		return NULL;
+	}
 
-void nrl_dfa_build(void) {
 	for (uint32_t i = 0; i < TII_COUNT; i++) {
-		const char *sequence = nrl_lookup_input(i);
-		if (sequence != NULL) {
-			dfa_insert(sequence, i);
+		if (inputs[i].data != NULL) {
+			dfa_insert(root, inputs[i], i);
 		}
 	}
+
+	return root;
 }
 
-bool nrl_dfa_parse(char (*next_char)(), terminfo_input *accept_buf) {
+void nrl_dfa_free(dfa_node *root) {
+	if (root != NULL) {
+		free_children(root);
+		free(root);
+	}
+}
+
+bool nrl_dfa_parse(const dfa_node *root,
+				   char (*next_char)(),
+				   terminfo_input *accept_buf) {
 	// Empty tree
-	if (root.children_count == 0) {
+	if (root->children_count == 0) {
 		return false;
 	}
 
-	const dfa_node *trav = &root;
+	const dfa_node *trav = root;
 
 	while (true) {
 		char input = next_char();
 		for (uint32_t i = 0; i < trav->children_count; i++) {
 			const dfa_node *child = &trav->value.children[i];
 			if (input == child->edge) {
+				STATS_ADD(dfa_states, 1);
+
 				// Check if leaf node reached
 				if (child->children_count == 0) {
+					STATS_ADD(dfa_matches, 1);
+					PROBE1(dfa__accept, child->value.accept);
 					*accept_buf = child->value.accept;
 					return true;
 				}
@@ -94,6 +107,7 @@ bool nrl_dfa_parse(char (*next_char)(), terminfo_input *accept_buf) {
 			}
 		}
 
+		PROBE1(dfa__reject, input);
 		return false;
 
 		// For breaking out of inner for loop
@@ -125,22 +139,25 @@ void print_helper(const dfa_node *node, uint32_t indent) {
 	}
 }
 
-void nrl_dfa_print(void) {
-	print_helper(&root, 0);
+void nrl_dfa_print(const dfa_node *root) {
+	print_helper(root, 0);
 }
 #endif
 
 /**
  * @brief Insert a new sequence into the DFA tree.
  *
+ * @param[in,out] root - Root of the DFA.
  * @param[in] sequence - Sequence to add.
  * @param[in] accept_value - Output value on completed match.
  */
-static void dfa_insert(const char *sequence, terminfo_input accept_value) {
-	dfa_node *current = &root;
+static void dfa_insert(dfa_node *root,
+					   terminfo_seq sequence,
+					   terminfo_input accept_value) {
+	dfa_node *current = root;
 
-	char edge;
-	while ((edge = *sequence++) != '\0') {
+	for (uint32_t pos = 0; pos < sequence.length; pos++) {
+		char edge = sequence.data[pos];
 		for (uint32_t i = 0; i < current->children_count; i++) {
 			dfa_node *child = current->value.children + i;
 			if (child->edge == edge) {
@@ -168,4 +185,19 @@ insert_next:
 	current->value.accept = accept_value;
 }
 
+/**
+ * @brief Free all nodes below a node.
+ *
+ * @param[in,out] node - Tree node.
+ */
+static void free_children(dfa_node *node) {
+	for (uint32_t i = 0; i < node->children_count; i++) {
+		free_children(&node->value.children[i]);
+	}
+
+	if (node->children_count > 0) {
+		free(node->value.children);
+	}
+}
+
 // @endcond
@@ -14,26 +14,43 @@
 #include "config.h"
 #include "terminfo.h"
 
+typedef struct dfa_node dfa_node;
+
 /**
  * @brief Build an escape sequence DFA from terminfo data.
+ *
+ * @param[in] inputs - Input sequences, indexed by @ref terminfo_input.
+ * @return Root of the DFA; NULL if allocation failed.
  */
-void nrl_dfa_build(void);
+dfa_node *nrl_dfa_build(const terminfo_seq *inputs);
+
+/**
+ * @brief Free a DFA.
+ *
+ * @param[in] root - Root of the DFA (can be NULL).
+ */
+void nrl_dfa_free(dfa_node *root);
 
 /**
  * @brief Run the escape sequence parser.
  *
+ * @param[in] root - Root of the DFA.
  * @param[in] next_char - Next character acquisition function.
  * @param[out] accept_buf - Buffer for parsed escape sequence.
  * @return true - Escape sequence parsed. \n
  *         false - Nothing was matched.
  */
-bool nrl_dfa_parse(char (*next_char)(), terminfo_input *accept_buf);
+bool nrl_dfa_parse(const dfa_node *root,
+				   char (*next_char)(),
+				   terminfo_input *accept_buf);
 
 #if DFA_DEBUG == 1
 /**
  * @brief Print DFA tree to standard out.
+ *
+ * @param[in] root - Root of the DFA.
  */
-void nrl_dfa_print(void);
+void nrl_dfa_print(const dfa_node *root);
 #endif // DEBUG
 
 // @endcond
@@ -13,23 +13,51 @@
 #include "config.h"
 
 #if FASTLOAD == 1
+#include <stdint.h>
 #include <string.h>
 
 #include "terminfo.h"
 
 static const char *xterm_inputs_stub[TII_COUNT] = {
-	"\033OD", "\033OC", "\177", "\033OH", "\033OF", "\033[3~",
+	"\033OD",
+	"\033OC",
+	"\177",
+	"\033OH",
+	"\033OF",
+	"\033[3~",
+	"\033[1;5D",
+	"\033[1;5C",
+	"\033[1;3D",
+	"\033[1;3C",
+	"\033[3;5~",
+	"\033[200~",
+	"\033[201~",
 };
 static const char *xterm_outputs_stub[TIO_COUNT] = {
 	"\b",
 	"\033[C",
+	"\033[A",
+	"\n",
 	"\033[?1l\033>",
 	"\033[?1h\033=",
+	"\033[J",
+	"\033[%p1%dD",
+	"\033[%p1%dC",
+	"\033[%p1%dA",
+	"\033[%p1%dB",
+	"\033[?2004h",
+	"\033[?2004l",
 };
 
-void nrl_fl_xterm(char **inputs, char **outputs) {
-	memcpy(inputs, &xterm_inputs_stub, TII_COUNT * sizeof(char *));
-	memcpy(outputs, &xterm_outputs_stub, TIO_COUNT * sizeof(char *));
+void nrl_fl_xterm(terminfo_seq *inputs, terminfo_seq *outputs) {
+	for (uint32_t i = 0; i < TII_COUNT; i++) {
+		inputs[i].data = xterm_inputs_stub[i];
+		inputs[i].length = strlen(xterm_inputs_stub[i]);
+	}
+	for (uint32_t i = 0; i < TIO_COUNT; i++) {
+		outputs[i].data = xterm_outputs_stub[i];
+		outputs[i].length = strlen(xterm_outputs_stub[i]);
+	}
 }
 #endif // FASTLOAD
 
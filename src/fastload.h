@@ -10,6 +10,7 @@
 #pragma once
 
 #include "config.h"
+#include "terminfo.h"
 
 #if FASTLOAD == 1
 /**
@@ -18,7 +19,7 @@
  * @param[out] inputs - Input storage to fill.
  * @param[out] outputs - Output storage to fill.
  */
-void nrl_fl_xterm(char **inputs, char **outputs);
+void nrl_fl_xterm(terminfo_seq *inputs, terminfo_seq *outputs);
 #endif // FASTLOAD
 
 // @endcond
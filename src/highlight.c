@@ -0,0 +1,191 @@
+/**
+ * @cond internal
+ * @file highlight.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Incremental syntax highlighting.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "highlight.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <c-utils/vector.h>
+
+#include "io.h"
+#include "manip.h"
+#include "nanorl.h"
+
+/**
+ * @struct span_entry
+ * Cached highlighting result.
+ *
+ * @var span_entry::span
+ * Span returned by the hook.
+ *
+ * @var span_entry::state
+ * Lexer state after the span, used to resume lexing.
+ */
+typedef struct {
+	nrl_span span;
+	uint64_t state;
+} span_entry;
+
+static nrl_highlighter hook = NULL;
+
+/**
+ * Span cache for the current line, ordered by position.
+ */
+static vector cache;
+
+static uint32_t find_span(uint32_t pos);
+static bool write_plain(const char *data, uint32_t from, uint32_t to);
+
+void nrl_highlight_init(nrl_highlighter highlighter) {
+	hook = highlighter;
+	cache = vec_init(sizeof(span_entry));
+}
+
+bool nrl_highlight_enabled(void) {
+	return hook != NULL;
+}
+
+uint32_t nrl_highlight_update(const line_data *line, uint32_t from) {
+	// Spans ending before the change are kept
+	uint32_t keep = find_span(from);
+	if (keep > 0) {
+		// Token ending right at the change may continue into it
+		const span_entry *prev = (span_entry *)cache.data + keep - 1;
+		if (prev->span.start + prev->span.length == from) {
+			keep--;
+		}
+	}
+
+	// Styles may only differ from the first dropped or added span
+	uint32_t restyled = from;
+	if (keep < cache.count) {
+		const span_entry *dropped = (span_entry *)cache.data + keep;
+		if (dropped->span.start < restyled) {
+			restyled = dropped->span.start;
+		}
+	}
+	cache.count = keep;
+
+	uint32_t offset = 0;
+	uint64_t state = 0;
+	if (keep > 0) {
+		const span_entry *last = (span_entry *)cache.data + keep - 1;
+		offset = last->span.start + last->span.length;
+		state = last->state;
+	}
+
+	const char *data = line->buffer.data;
+	uint32_t length = line->buffer.count;
+
+	span_entry entry;
+	while (offset < length
+		   && hook(data, length, offset, &state, &entry.span)) {
+		// Reject malformed spans
+		if (entry.span.start < offset || entry.span.start >= length
+			|| entry.span.length == 0) {
+			break;
+		}
+		if (entry.span.length > length - entry.span.start) {
+			entry.span.length = length - entry.span.start;
+		}
+
+		if (cache.count == keep && entry.span.start < restyled) {
+			restyled = entry.span.start;
+		}
+
+		entry.state = state;
+		vec_push(&cache, &entry);
+		offset = entry.span.start + entry.span.length;
+	}
+
+	return restyled;
+}
+
+bool nrl_highlight_write(const line_data *line, uint32_t from, uint32_t to) {
+	const char *data = line->buffer.data;
+	const span_entry *spans = cache.data;
+
+	uint32_t pos = from;
+	for (uint32_t i = find_span(from); i < cache.count && pos < to; i++) {
+		const nrl_span *span = &spans[i].span;
+		uint32_t span_end = span->start + span->length;
+
+		// Unstyled text before span
+		if (span->start > pos) {
+			uint32_t plain_end = (span->start < to) ? span->start : to;
+			if (!write_plain(data, pos, plain_end)) {
+				return false;
+			}
+			pos = plain_end;
+		}
+		if (pos >= to) {
+			break;
+		}
+
+		uint32_t styled_end = (span_end < to) ? span_end : to;
+		if (!nrl_io_write("\033[", 2)
+			|| !nrl_io_write(span->style, strlen(span->style))
+			|| !nrl_io_write("m", 1) || !write_plain(data, pos, styled_end)
+			|| !nrl_io_write("\033[m", 3)) {
+			return false;
+		}
+		pos = styled_end;
+	}
+
+	return write_plain(data, pos, to);
+}
+
+void nrl_highlight_deinit(void) {
+	vec_deinit(&cache);
+	hook = NULL;
+}
+
+/**
+ * @brief Find first cached span which ends after a position.
+ *
+ * @param[in] pos - Character position.
+ * @return Index into the cache; cache count if there are none.
+ */
+static uint32_t find_span(uint32_t pos) {
+	const span_entry *spans = cache.data;
+
+	uint32_t low = 0;
+	uint32_t high = cache.count;
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		if (spans[mid].span.start + spans[mid].span.length <= pos) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+/**
+ * @brief Write part of the line without styling.
+ *
+ * @param[in] data - Line data.
+ * @param[in] from - First character to write.
+ * @param[in] to - Character to stop at (exclusive).
+ * @return Whether write succeeded.
+ */
+static bool write_plain(const char *data, uint32_t from, uint32_t to) {
+	if (from >= to) {
+		return true;
+	}
+
+	return nrl_io_write(data + from, to - from);
+}
+
+// @endcond
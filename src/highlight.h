@@ -0,0 +1,56 @@
+/**
+ * @cond internal
+ * @file highlight.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Incremental syntax highlighting.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "manip.h"
+#include "nanorl.h"
+
+/**
+ * @brief Set highlighting hook and reset span cache.
+ *
+ * @param[in] highlighter - Highlighting hook, or NULL to disable.
+ */
+void nrl_highlight_init(nrl_highlighter highlighter);
+
+/**
+ * @brief Check if highlighting is enabled.
+ *
+ * @return Whether a hook is set.
+ */
+bool nrl_highlight_enabled(void);
+
+/**
+ * @brief Recompute spans after the line has been modified.
+ *
+ * @param[in] line - Line data object.
+ * @param[in] from - First modified character.
+ * @return First character which may have changed style.
+ */
+uint32_t nrl_highlight_update(const line_data *line, uint32_t from);
+
+/**
+ * @brief Write part of the line with style sequences.
+ *
+ * @param[in] line - Line data object.
+ * @param[in] from - First character to write.
+ * @param[in] to - Character to stop at (exclusive).
+ * @return Whether write succeeded.
+ */
+bool nrl_highlight_write(const line_data *line, uint32_t from, uint32_t to);
+
+/**
+ * @brief Free span cache.
+ */
+void nrl_highlight_deinit(void);
+
+// @endcond
@@ -0,0 +1,1051 @@
+/**
+ * @cond internal
+ * @file history.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Line history.
+ *
+ * History file format: a header of the magic "NRLH", a version byte, three
+ * zero bytes and the 64-bit offset where the records written by the last
+ * compaction end. Each record is the text length and a checksum of the length
+ * and the text, as 32-bit integers, followed by the text. Integers are
+ * little-endian.
+ *
+ * Records are appended with single O_APPEND writes, so they are not
+ * interleaved. Readers remember how far they have read and skip records
+ * that fail the checksum. Writers read the file back after appending, which
+ * loads their own entry in file order.
+ *
+ * Compaction appends a seal (an empty record), copies the most recent records
+ * before it to a new file and renames it over the old one. Readers stop at the
+ * seal and continue reading the new file from the end of the compacted
+ * records. Writers whose record landed after the seal append it again to the
+ * new file, once it is in place.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "history.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <c-utils/vector.h>
+
+#include "config.h"
+#include "nanorl.h"
+
+/**
+ * @def NO_ENTRY
+ * Entry index representing no entry.
+ */
+#define NO_ENTRY UINT32_MAX
+
+#define FILE_MAGIC "NRLH"
+#define FILE_MAGIC_SIZE 4
+#define FILE_VERSION 1
+#define FILE_HEADER_SIZE 16
+#define RECORD_HEADER_SIZE 8
+
+/**
+ * @def NO_RECORD
+ * Record length representing no whole record.
+ */
+#define NO_RECORD UINT32_MAX
+
+/**
+ * @def CLOSE_WAIT_MS
+ * Time to wait on close for a sealed file to be replaced.
+ */
+#define CLOSE_WAIT_MS 1000
+
+/**
+ * @def CLAIM_STALE_SECONDS
+ * Age after which a compaction claim is assumed to be left by a crash.
+ */
+#define CLAIM_STALE_SECONDS 10
+
+typedef struct history_node history_node;
+
+/**
+ * @struct history_node
+ * Prefix tree node.
+ *
+ * @var history_node::edge
+ * Value required to enter this node from a previous node.
+ *
+ * @var history_node::latest
+ * Most recent entry with the prefix leading to this node.
+ *
+ * @var history_node::children
+ * Array of child nodes.
+ *
+ * @var history_node::children_count
+ * Count of children.
+ */
+struct history_node {
+	char edge;
+	uint32_t latest;
+	history_node *children;
+	uint32_t children_count;
+};
+
+/**
+ * @struct history_entry
+ *
+ * @var history_entry::text
+ * Entry text, null-terminated.
+ *
+ * @var history_entry::length
+ * Text length.
+ *
+ * @var history_entry::older
+ * For entries longer than the index depth - previous entry sharing the
+ * indexed prefix.
+ */
+typedef struct {
+	char *text;
+	uint32_t length;
+	uint32_t older;
+} history_entry;
+
+/**
+ * @var root
+ * Root prefix tree element. Its edge value does not matter.
+ */
+static history_node root = {
+	.edge = '\0',
+	.latest = NO_ENTRY,
+	.children = NULL,
+	.children_count = 0,
+};
+
+/**
+ * @var entries
+ * All entries, oldest first.
+ */
+static vector entries = { 0 };
+static bool entries_ready = false;
+
+/**
+ * Shared history file; -1 if not open.
+ */
+static int history_file = -1;
+static char *history_path = NULL;
+
+/**
+ * Offset in the history file up to which records are loaded.
+ */
+static uint64_t history_offset = 0;
+
+/**
+ * Entries to append to the history file later: lines added while the loader
+ * runs, and records that landed after a seal. Only used outside the loader.
+ */
+static vector pending = { 0 };
+static bool pending_ready = false;
+
+/**
+ * Thread loading the history file after it is opened. While it runs, it
+ * owns the history file; other history state is not touched.
+ */
+static pthread_t loader;
+static bool loading = false;
+
+/**
+ * Set by the loader once it is done; accessed atomically.
+ */
+static bool loaded = false;
+
+/**
+ * Guards the index, so suggestions use entries loaded so far.
+ */
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void insert(const char *text, uint32_t length);
+static const char *find_suggestion(const char *prefix,
+								   uint32_t length,
+								   uint32_t *suggestion_length);
+static void *load_file(void *arg);
+static void wait_loaded(void);
+static bool load_done(void);
+static void sync_file(void);
+static history_node *find_child(const history_node *node, char edge);
+static void free_node(history_node *node);
+static int open_file(const char *path, uint64_t *base);
+static bool write_file(const char *path, const char *records, size_t size);
+static bool write_all(int fd, const char *data, size_t size);
+static bool share(const char *text, uint32_t length);
+static void defer(const char *text, uint32_t length);
+static bool flush_pending(void);
+static void free_pending(void);
+static uint64_t append_record(const char *text, uint32_t length);
+static char *read_range(uint64_t start, uint64_t end, size_t *loaded);
+static uint32_t next_record(const char *data, size_t size, size_t *pos);
+static bool read_tail(void);
+static bool follow_file(void);
+static void compact(void);
+static void replace_file(void);
+static uint32_t encode_record(char *buf, const char *text, uint32_t length);
+static uint32_t checksum(const char *record, uint32_t length);
+static void write_u32(char *buf, uint32_t value);
+static uint32_t read_u32(const char *buf);
+
+void nrl_history_add(const char *line) {
+	uint32_t length = strlen(line);
+	if (length == 0) {
+		return;
+	}
+
+	if (history_file >= 0) {
+		// Loader owns the file until it is done, and lines waiting to be
+		// appended keep their order
+		if (!load_done() || !flush_pending()) {
+			defer(line, length);
+		} else if (share(line, length)) {
+			return;
+		}
+	}
+
+	insert(line, length);
+}
+
+bool nrl_history_open(const char *path) {
+	nrl_history_close();
+
+	uint64_t base;
+	int fd = open_file(path, &base);
+	if (fd < 0) {
+		return false;
+	}
+
+	history_path = strdup(path);
+	if (history_path == NULL) {
+		close(fd);
+		return false;
+	}
+
+	// Initial load includes the compacted records
+	history_file = fd;
+	history_offset = FILE_HEADER_SIZE;
+
+	// Large files would delay the first prompt
+	loaded = false;
+	loading = (pthread_create(&loader, NULL, &load_file, NULL) == 0);
+	if (!loading) {
+		sync_file();
+	}
+
+	return true;
+}
+
+void nrl_history_close(void) {
+	wait_loaded();
+	if (history_file < 0) {
+		return;
+	}
+
+	// Deferred entries are kept if compaction finishes in time
+	for (uint32_t waited = 0; !flush_pending(); waited++) {
+		if (waited == CLOSE_WAIT_MS) {
+			break;
+		}
+		struct timespec delay = { .tv_sec = 0, .tv_nsec = 1000000 };
+		nanosleep(&delay, NULL);
+	}
+	free_pending();
+
+	close(history_file);
+	free(history_path);
+	history_file = -1;
+	history_path = NULL;
+	history_offset = 0;
+}
+
+void nrl_history_sync(void) {
+	// Loader reads up to the current end of the file
+	if (history_file < 0 || !load_done()) {
+		return;
+	}
+
+	sync_file();
+	flush_pending();
+}
+
+void nrl_history_clear(void) {
+	wait_loaded();
+	free_node(&root);
+	root.latest = NO_ENTRY;
+	root.children = NULL;
+	root.children_count = 0;
+
+	if (!entries_ready) {
+		return;
+	}
+
+	history_entry *list = entries.data;
+	for (uint32_t i = 0; i < entries.count; i++) {
+		free(list[i].text);
+	}
+	vec_deinit(&entries);
+	entries_ready = false;
+}
+
+const char *nrl_history_suggest(const char *prefix,
+								uint32_t length,
+								uint32_t *suggestion_length) {
+	if (length == 0) {
+		return NULL;
+	}
+
+	// Entries are published as the loader reads them, so typing never waits
+	// for the whole file
+	pthread_mutex_lock(&index_lock);
+	const char *suggestion
+		= find_suggestion(prefix, length, suggestion_length);
+	pthread_mutex_unlock(&index_lock);
+
+	return suggestion;
+}
+
+/**
+ * @brief Add an entry to memory.
+ *
+ * @param[in] text - Entry text (not null-terminated).
+ * @param[in] length - Text length; not 0.
+ */
+static void insert(const char *text, uint32_t length) {
+	char *copy = malloc(length + 1);
+	if (copy == NULL) {
+		return;
+	}
+	memcpy(copy, text, length);
+	copy[length] = '\0';
+
+	pthread_mutex_lock(&index_lock);
+
+	// Nodes are added first, so a failed allocation leaves no partial entry
+	history_node *current = &root;
+	uint32_t depth = (length < HISTORY_INDEX_DEPTH) ? length
+													: HISTORY_INDEX_DEPTH;
+	for (uint32_t i = 0; i < depth; i++) {
+		history_node *child = find_child(current, text[i]);
+
+		if (child == NULL) {
+			history_node *children
+				= realloc(current->children,
+						  (current->children_count + 1) * sizeof(history_node));
+			if (children == NULL) {
+				pthread_mutex_unlock(&index_lock);
+				free(copy);
+				return;
+			}
+
+			current->children = children;
+			child = children + current->children_count;
+			current->children_count++;
+
+			child->edge = text[i];
+			child->latest = NO_ENTRY;
+			child->children = NULL;
+			child->children_count = 0;
+		}
+
+		current = child;
+	}
+
+	if (!entries_ready) {
+		entries = vec_init(sizeof(history_entry));
+		entries_ready = true;
+	}
+
+	uint32_t index = entries.count;
+	history_entry entry = {
+		.text = copy,
+		.length = length,
+		.older = NO_ENTRY,
+	};
+
+	// Mark entry as latest along its prefix
+	current = &root;
+	for (uint32_t i = 0; i < depth; i++) {
+		current = find_child(current, text[i]);
+
+		// Past the index depth entries are chained instead
+		if (i == HISTORY_INDEX_DEPTH - 1) {
+			entry.older = current->latest;
+		}
+
+		current->latest = index;
+	}
+
+	vec_push(&entries, &entry);
+	pthread_mutex_unlock(&index_lock);
+}
+
+/**
+ * @brief Find the most recent entry extending a prefix.
+ *
+ * @param[in] prefix - Typed text.
+ * @param[in] length - Prefix length; not 0.
+ * @param[out] suggestion_length - Length of the returned text.
+ * @return Rest of the entry after the prefix; NULL if there is none.
+ * @note Called with index_lock held.
+ */
+static const char *find_suggestion(const char *prefix,
+								   uint32_t length,
+								   uint32_t *suggestion_length) {
+	const history_node *current = &root;
+	uint32_t depth = (length < HISTORY_INDEX_DEPTH) ? length
+													: HISTORY_INDEX_DEPTH;
+	for (uint32_t i = 0; i < depth; i++) {
+		current = find_child(current, prefix[i]);
+		if (current == NULL) {
+			return NULL;
+		}
+	}
+
+	// Check remaining prefix on chained entries
+	const history_entry *list = entries.data;
+	uint32_t index = current->latest;
+	while (index != NO_ENTRY) {
+		const history_entry *entry = &list[index];
+		if (entry->length >= length
+			&& memcmp(entry->text + depth, prefix + depth, length - depth)
+				   == 0) {
+			break;
+		}
+
+		index = entry->older;
+	}
+
+	if (index == NO_ENTRY || list[index].length == length) {
+		return NULL;
+	}
+
+	*suggestion_length = list[index].length - length;
+	return list[index].text + length;
+}
+
+/**
+ * @brief Load the history file in the background.
+ *
+ * @param[in] arg - Unused.
+ * @return NULL.
+ */
+static void *load_file(void *arg) {
+	(void)arg;
+	sync_file();
+
+	__atomic_store_n(&loaded, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/**
+ * @brief Wait for the history file to be loaded.
+ */
+static void wait_loaded(void) {
+	if (loading) {
+		pthread_join(loader, NULL);
+		loading = false;
+	}
+}
+
+/**
+ * @brief Finish loading without waiting, if the loader is done.
+ *
+ * @return Whether the history file can be used outside the loader.
+ */
+static bool load_done(void) {
+	if (loading && __atomic_load_n(&loaded, __ATOMIC_ACQUIRE)) {
+		wait_loaded();
+	}
+
+	return !loading;
+}
+
+/**
+ * @brief Load new records, follow the file and compact it if needed.
+ */
+static void sync_file(void) {
+	// Old file is read up to the seal before switching
+	if (read_tail() && follow_file()) {
+		read_tail();
+	}
+
+	if (history_offset > HISTORY_FILE_SIZE) {
+		compact();
+	}
+}
+
+/**
+ * @brief Find child node by edge value.
+ *
+ * @param[in] node - Parent node.
+ * @param[in] edge - Edge value.
+ * @return Child node; NULL if not found.
+ */
+static history_node *find_child(const history_node *node, char edge) {
+	for (uint32_t i = 0; i < node->children_count; i++) {
+		if (node->children[i].edge == edge) {
+			return node->children + i;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Free all children of a node.
+ *
+ * @param[in] node - Tree node.
+ */
+static void free_node(history_node *node) {
+	for (uint32_t i = 0; i < node->children_count; i++) {
+		free_node(node->children + i);
+	}
+
+	free(node->children);
+}
+
+/**
+ * @brief Open a history file, creating it if missing.
+ *
+ * @param[in] path - File path.
+ * @param[out] base - Offset where the compacted records end.
+ * @return Open file descriptor; -1 on failure.
+ */
+static int open_file(const char *path, uint64_t *base) {
+	int fd = open(path, O_RDWR | O_APPEND | O_CLOEXEC);
+
+	// Created under another name and linked, so it never appears empty
+	if (fd < 0 && errno == ENOENT) {
+		char temp[strlen(path) + 32];
+		sprintf(temp, "%s.%ld.tmp", path, (long)getpid());
+
+		// Entries in memory are not shared
+		if (!write_file(temp, NULL, 0)) {
+			return -1;
+		}
+		if (link(temp, path) < 0 && errno != EEXIST) {
+			unlink(temp);
+			return -1;
+		}
+		unlink(temp);
+
+		fd = open(path, O_RDWR | O_APPEND | O_CLOEXEC);
+	}
+	if (fd < 0) {
+		return -1;
+	}
+
+	char header[FILE_HEADER_SIZE];
+	if (pread(fd, header, FILE_HEADER_SIZE, 0) != FILE_HEADER_SIZE
+		|| memcmp(header, FILE_MAGIC, FILE_MAGIC_SIZE) != 0
+		|| header[FILE_MAGIC_SIZE] != FILE_VERSION) {
+		close(fd);
+		return -1;
+	}
+
+	*base = read_u32(header + 8) | (uint64_t)read_u32(header + 12) << 32;
+	if (*base < FILE_HEADER_SIZE) {
+		*base = FILE_HEADER_SIZE;
+	}
+
+	return fd;
+}
+
+/**
+ * @brief Write a new history file.
+ *
+ * @param[in] path - File path; replaced if it exists.
+ * @param[in] records - Encoded records; can be NULL if size is 0.
+ * @param[in] size - Size of the records.
+ * @return Whether the file was written.
+ */
+static bool write_file(const char *path, const char *records, size_t size) {
+	uint64_t end = FILE_HEADER_SIZE + size;
+
+	char header[FILE_HEADER_SIZE];
+	memset(header, 0, FILE_HEADER_SIZE);
+	memcpy(header, FILE_MAGIC, FILE_MAGIC_SIZE);
+	header[FILE_MAGIC_SIZE] = FILE_VERSION;
+	write_u32(header + 8, (uint32_t)end);
+	write_u32(header + 12, (uint32_t)(end >> 32));
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		return false;
+	}
+
+	// Contents must be stored before the file replaces another
+	bool res = write_all(fd, header, FILE_HEADER_SIZE)
+		&& write_all(fd, records, size) && fsync(fd) == 0;
+	if (close(fd) < 0 || !res) {
+		unlink(path);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Write a whole buffer to a file.
+ *
+ * @param[in] fd - File descriptor.
+ * @param[in] data - Data buffer.
+ * @param[in] size - Data size.
+ * @return Whether all data was written.
+ */
+static bool write_all(int fd, const char *data, size_t size) {
+	size_t written = 0;
+	while (written < size) {
+		ssize_t bytes = write(fd, data + written, size - written);
+		if (bytes < 0) {
+			return false;
+		}
+		written += bytes;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Append an entry to the history file and load it back.
+ *
+ * @param[in] text - Entry text.
+ * @param[in] length - Text length.
+ * @return true - Entry is in the file and loaded. \n
+ *         false - Entry has to be added to memory; it may still be appended
+ *         to the file later.
+ */
+static bool share(const char *text, uint32_t length) {
+	uint64_t end = append_record(text, length);
+
+	while (end != 0) {
+		bool sealed = read_tail();
+		if (history_offset >= end || !sealed) {
+			return true;
+		}
+
+		// Record is past the seal, so it belongs in the new file
+		if (!follow_file()) {
+			// Compaction is still writing the new file
+			defer(text, length);
+			return false;
+		}
+
+		end = append_record(text, length);
+	}
+
+	return false;
+}
+
+/**
+ * @brief Keep an entry to append once the new file is in place.
+ *
+ * @param[in] text - Entry text.
+ * @param[in] length - Text length.
+ */
+static void defer(const char *text, uint32_t length) {
+	char *copy = malloc(length);
+	if (copy == NULL) {
+		return;
+	}
+	memcpy(copy, text, length);
+
+	if (!pending_ready) {
+		pending = vec_init(sizeof(history_entry));
+		pending_ready = true;
+	}
+
+	history_entry entry = {
+		.text = copy,
+		.length = length,
+		.older = NO_ENTRY,
+	};
+	vec_push(&pending, &entry);
+}
+
+/**
+ * @brief Append deferred entries to the history file, in order.
+ *
+ * @return Whether no entries are left deferred.
+ * @note Entries are loaded again from the file, like lines added twice.
+ */
+static bool flush_pending(void) {
+	if (!pending_ready) {
+		return true;
+	}
+
+	// Sealed file takes no more records
+	if (read_tail() && !follow_file()) {
+		return false;
+	}
+
+	// Entries are taken first, since sharing may defer them again
+	vector list = pending;
+	pending_ready = false;
+
+	history_entry *entry = list.data;
+	uint32_t i = 0;
+	while (i < list.count && share(entry[i].text, entry[i].length)) {
+		i++;
+	}
+
+	// Entries after one that waits again keep waiting
+	for (i++; i < list.count; i++) {
+		defer(entry[i].text, entry[i].length);
+	}
+
+	for (i = 0; i < list.count; i++) {
+		free(entry[i].text);
+	}
+	vec_deinit(&list);
+
+	return !pending_ready;
+}
+
+/**
+ * @brief Drop deferred entries.
+ */
+static void free_pending(void) {
+	if (!pending_ready) {
+		return;
+	}
+
+	history_entry *list = pending.data;
+	for (uint32_t i = 0; i < pending.count; i++) {
+		free(list[i].text);
+	}
+	vec_deinit(&pending);
+	pending_ready = false;
+}
+
+/**
+ * @brief Append a record to the history file.
+ *
+ * @param[in] text - Entry text; empty for a seal.
+ * @param[in] length - Text length.
+ * @return File offset after the record; 0 if it was not written whole.
+ */
+static uint64_t append_record(const char *text, uint32_t length) {
+	if (length > HISTORY_RECORD_MAX) {
+		return 0;
+	}
+
+	char *record = malloc(RECORD_HEADER_SIZE + length);
+	if (record == NULL) {
+		return 0;
+	}
+
+	// Single write, so records of other processes are not interleaved
+	uint32_t size = encode_record(record, text, length);
+	ssize_t bytes = write(history_file, record, size);
+	free(record);
+
+	if (bytes != (ssize_t)size) {
+		return 0;
+	}
+
+	// Appending leaves the offset after the written data
+	off_t end = lseek(history_file, 0, SEEK_CUR);
+	return (end > 0) ? (uint64_t)end : 0;
+}
+
+/**
+ * @brief Load records appended after the last read offset.
+ *
+ * @return Whether reading stopped at a seal.
+ * @note A record still being written is left for the next call.
+ */
+static bool read_tail(void) {
+	struct stat info;
+	if (fstat(history_file, &info) < 0) {
+		return false;
+	}
+	if ((uint64_t)info.st_size <= history_offset) {
+		return false;
+	}
+
+	size_t loaded;
+	char *data = read_range(history_offset, info.st_size, &loaded);
+	if (data == NULL) {
+		return false;
+	}
+
+	size_t pos = 0;
+	bool sealed = false;
+	uint32_t length;
+	while ((length = next_record(data, loaded, &pos)) != NO_RECORD) {
+		// Records after the seal are appended again to the new file
+		if (length == 0) {
+			sealed = true;
+			break;
+		}
+
+		insert(data + pos + RECORD_HEADER_SIZE, length);
+		pos += RECORD_HEADER_SIZE + length;
+	}
+
+	history_offset += pos;
+	free(data);
+	return sealed;
+}
+
+/**
+ * @brief Read part of the history file.
+ *
+ * @param[in] start - Offset to read from.
+ * @param[in] end - Offset to stop at; past start.
+ * @param[out] loaded - Amount of bytes read; less than requested on errors.
+ * @return Allocated data; NULL on failure.
+ */
+static char *read_range(uint64_t start, uint64_t end, size_t *loaded) {
+	size_t size = end - start;
+	char *data = malloc(size);
+	if (data == NULL) {
+		return NULL;
+	}
+
+	*loaded = 0;
+	while (*loaded < size) {
+		ssize_t bytes = pread(history_file, data + *loaded, size - *loaded,
+							  start + *loaded);
+		if (bytes <= 0) {
+			break;
+		}
+		*loaded += bytes;
+	}
+
+	return data;
+}
+
+/**
+ * @brief Find the next valid record in file data.
+ *
+ * @param[in] data - File data.
+ * @param[in] size - Data size.
+ * @param[in,out] pos - Offset to search from; moved to the record found.
+ * @return Text length; 0 for a seal; NO_RECORD if no whole record is left.
+ * @note Damaged records are skipped a byte at a time, until one is valid.
+ */
+static uint32_t next_record(const char *data, size_t size, size_t *pos) {
+	while (size - *pos >= RECORD_HEADER_SIZE) {
+		const char *record = data + *pos;
+		uint32_t length = read_u32(record);
+
+		if (length > HISTORY_RECORD_MAX) {
+			(*pos)++;
+			continue;
+		}
+		if (size - *pos - RECORD_HEADER_SIZE < length) {
+			return NO_RECORD;
+		}
+		if (checksum(record, length) != read_u32(record + 4)) {
+			(*pos)++;
+			continue;
+		}
+
+		return length;
+	}
+
+	return NO_RECORD;
+}
+
+/**
+ * @brief Switch to the file at the history path, if it was replaced.
+ *
+ * @return Whether the file was switched.
+ * @note Only records appended after the compacted ones are left to read.
+ */
+static bool follow_file(void) {
+	struct stat current;
+	struct stat opened;
+	if (stat(history_path, &current) < 0
+		|| fstat(history_file, &opened) < 0) {
+		return false;
+	}
+
+	if (current.st_dev == opened.st_dev && current.st_ino == opened.st_ino) {
+		return false;
+	}
+
+	uint64_t base;
+	int fd = open_file(history_path, &base);
+	if (fd < 0) {
+		return false;
+	}
+
+	close(history_file);
+	history_file = fd;
+	history_offset = base;
+
+	return true;
+}
+
+/**
+ * @brief Replace the history file with the most recent entries.
+ *
+ * @note Processes that do not sync across two compactions miss the entries
+ * added between them.
+ */
+static void compact(void) {
+	// Only one process compacts at a time
+	char claim[strlen(history_path) + 16];
+	sprintf(claim, "%s.compact", history_path);
+
+	int claim_fd = open(claim, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (claim_fd < 0) {
+		// Claim left by a crash is removed for the next attempt
+		struct stat info;
+		if (errno == EEXIST && stat(claim, &info) == 0
+			&& time(NULL) - info.st_mtime > CLAIM_STALE_SECONDS) {
+			unlink(claim);
+		}
+		return;
+	}
+	close(claim_fd);
+
+	// File compacted by another process since the last sync is left alone
+	if (follow_file()) {
+		unlink(claim);
+		return;
+	}
+
+	// Records up to the seal are the ones compacted
+	if (append_record("", 0) != 0 && read_tail()) {
+		replace_file();
+	}
+
+	unlink(claim);
+}
+
+/**
+ * @brief Copy the most recent records before the seal to a new file at the
+ * history path.
+ *
+ * @note Records are read back from the sealed file, so entries cleared from
+ * memory or added before the file was opened do not matter.
+ */
+static void replace_file(void) {
+	size_t size;
+	char *data = read_range(FILE_HEADER_SIZE, history_offset, &size);
+	if (data == NULL) {
+		return;
+	}
+
+	uint64_t kept = FILE_HEADER_SIZE;
+	size_t pos = 0;
+	uint32_t length;
+	while ((length = next_record(data, size, &pos)) != NO_RECORD
+		   && length != 0) {
+		kept += RECORD_HEADER_SIZE + length;
+		pos += RECORD_HEADER_SIZE + length;
+	}
+
+	// Keep half of the limit, so compactions are rare
+	size_t copied = 0;
+	pos = 0;
+	while ((length = next_record(data, size, &pos)) != NO_RECORD
+		   && length != 0) {
+		uint32_t record_size = RECORD_HEADER_SIZE + length;
+		if (kept > HISTORY_FILE_SIZE / 2) {
+			kept -= record_size;
+		} else {
+			memmove(data + copied, data + pos, record_size);
+			copied += record_size;
+		}
+		pos += record_size;
+	}
+
+	char temp[strlen(history_path) + 32];
+	sprintf(temp, "%s.%ld.tmp", history_path, (long)getpid());
+	bool written = write_file(temp, data, copied);
+	free(data);
+	if (!written) {
+		return;
+	}
+	if (rename(temp, history_path) < 0) {
+		unlink(temp);
+		return;
+	}
+
+	// Compacted records were loaded up to the seal
+	follow_file();
+}
+
+/**
+ * @brief Encode a history record.
+ *
+ * @param[out] buf - Buffer of at least RECORD_HEADER_SIZE + length bytes.
+ * @param[in] text - Entry text.
+ * @param[in] length - Text length.
+ * @return Record size.
+ */
+static uint32_t encode_record(char *buf, const char *text, uint32_t length) {
+	write_u32(buf, length);
+	memcpy(buf + RECORD_HEADER_SIZE, text, length);
+	write_u32(buf + 4, checksum(buf, length));
+
+	return RECORD_HEADER_SIZE + length;
+}
+
+/**
+ * @brief Compute a record checksum (32-bit FNV-1a).
+ *
+ * @param[in] record - Record with the length and the text filled in.
+ * @param[in] length - Text length.
+ * @return Checksum of the length field and the text.
+ */
+static uint32_t checksum(const char *record, uint32_t length) {
+	uint32_t hash = 2166136261u;
+	for (uint32_t i = 0; i < 4; i++) {
+		hash = (hash ^ (unsigned char)record[i]) * 16777619u;
+	}
+
+	const char *text = record + RECORD_HEADER_SIZE;
+	for (uint32_t i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Write little-endian 32-bit integer.
+ *
+ * @param[out] buf - Integer location.
+ * @param[in] value - Integer value.
+ */
+static void write_u32(char *buf, uint32_t value) {
+	for (uint32_t i = 0; i < 4; i++) {
+		buf[i] = (char)(value >> (8 * i));
+	}
+}
+
+/**
+ * @brief Read little-endian 32-bit integer.
+ *
+ * @param[in] buf - Integer location.
+ * @return Integer value.
+ */
+static uint32_t read_u32(const char *buf) {
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < 4; i++) {
+		value |= (uint32_t)(unsigned char)buf[i] << (8 * i);
+	}
+
+	return value;
+}
+
+// @endcond
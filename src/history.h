@@ -0,0 +1,35 @@
+/**
+ * @cond internal
+ * @file history.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Line history.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Load entries added to the history file since the last call.
+ *
+ * @note Follows the file if it was replaced, and compacts it if it is too
+ * large.
+ */
+void nrl_history_sync(void);
+
+/**
+ * @brief Find the most recent history entry starting with a prefix.
+ *
+ * @param[in] prefix - Prefix data (not null-terminated).
+ * @param[in] length - Prefix length.
+ * @param[out] suggestion_length - Length of the suggestion.
+ * @return Remainder of the entry after the prefix; NULL if none found.
+ * @note Pointer is valid until history is modified.
+ */
+const char *nrl_history_suggest(const char *prefix,
+								uint32_t length,
+								uint32_t *suggestion_length);
+
+// @endcond
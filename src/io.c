@@ -11,19 +11,51 @@
 #include "io.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <c-utils/vector-ext.h>
+#include <c-utils/vector.h>
+
+#include "csi.h"
 #include "dfa.h"
+#include "probes.h"
+#include "stats.h"
 #include "terminfo.h"
 
+/**
+ * @def IO_BUF_SIZE
+ * Size of the input and output buffers; a power of two.
+ */
 #define IO_BUF_SIZE 4096
+#define IO_BUF_MASK (IO_BUF_SIZE - 1)
 #define CHAR_EOT 4
 
+/**
+ * @def MOVE_SEQ_SIZE
+ * Largest parameterized cursor movement sequence that is formatted.
+ */
+#define MOVE_SEQ_SIZE 32
+
 static int read_file = -1;
 static int echo_file = -1;
 
+/**
+ * Capabilities of the terminal in use.
+ */
+static const terminfo_snapshot *terminal = NULL;
+
+/**
+ * Input ring buffer. Positions only increase and are masked on access, so
+ * buffered input is [rd_used, rd_count) and a sequence being parsed is
+ * [rd_used, rd_used + rd_pending). Failed parses rewind to rd_used; partial
+ * sequences stay in place while more input is read after them.
+ */
 static char rd_buf[IO_BUF_SIZE];
 static uint32_t rd_count = 0;
 static uint32_t rd_used = 0;
@@ -31,59 +63,166 @@ static uint32_t rd_pending = 0;
 
 static char wr_buf[IO_BUF_SIZE];
 static uint32_t wr_count = 0;
+static uint64_t wr_total = 0;
 
-static const char *preload_data = NULL;
 static bool echo_enabled = false;
 
+static io_source input_source = NULL;
+static io_sink output_sink = NULL;
+static io_tap input_tap = NULL;
+
+/**
+ * Conditions that stop waiting for input. Deadline is in monotonic
+ * nanoseconds; 0 for none.
+ */
+static int wait_cancel = -1;
+static uint64_t wait_deadline = 0;
+
+static int notify_file = -1;
+static io_notify notify_handler = NULL;
+
 static char io_next_char(void);
+static bool ring_fill(void);
+static void ring_end_input(void);
+static uint32_t ring_contiguous(void);
+static bool ring_equals(uint32_t pos, const char *data, uint32_t length);
+static input_type classify_char(input_buf *buffer, char ascii);
+static uint32_t format_count(terminfo_seq seq, uint32_t count, char *out);
+static void read_paste(vector *text);
+static void append_paste(vector *text, const char *data, uint32_t length);
 static ssize_t read_wrapper(int fd, void *buf, size_t count);
-static bool parse_ascii_control(char ascii, input_buf *buffer);
+static bool wait_input(int fd);
+static uint64_t monotonic_ns(void);
+static bool write_wrapper(const char *data, uint32_t length);
+
+void nrl_io_init(int read_fd, int echo_fd) {
+	// Keep unread input, unless it belongs to another file
+	if (read_fd != read_file) {
+		rd_count = 0;
+		rd_used = 0;
+	}
+	rd_pending = 0;
 
-void nrl_io_init(int read_fd, int echo_fd, const char *preload) {
 	read_file = read_fd;
 	echo_file = echo_fd;
 
-	// Reset read buffer counters
-	rd_count = 0;
-	rd_used = 0;
-	rd_pending = 0;
-
 	// Reset echo buffer counters
 	wr_count = 0;
+}
+
+void nrl_io_terminal(const terminfo_snapshot *capabilities) {
+	terminal = capabilities;
+}
+
+void nrl_io_limit(int cancel_fd, uint32_t timeout_ms) {
+	wait_cancel = cancel_fd;
+	wait_deadline
+		= (timeout_ms > 0) ? monotonic_ns() + timeout_ms * 1000000ull : 0;
+}
 
-	// Handle preload
-	preload_data = preload;
+void nrl_io_notify(int fd, io_notify handler) {
+	notify_file = fd;
+	notify_handler = handler;
 }
 
 input_type nrl_io_read(input_buf *buffer) {
-	if (nrl_dfa_parse(&io_next_char, &buffer->escape)) {
+	if (nrl_dfa_parse(terminal->dfa, &io_next_char, &buffer->escape)) {
 		rd_used += rd_pending;
 		rd_pending = 0;
-		buffer->more = (rd_used < rd_count);
 
-		return INPUT_ESCAPE;
+		// Text up to the end marker is taken as is
+		bool paste = buffer->escape == TII_PASTE_START
+			&& nrl_lookup_input(terminal, TII_PASTE_END).data != NULL;
+		if (paste) {
+			read_paste(buffer->paste);
+		}
+
+		buffer->more = (rd_used != rd_count);
+		return paste ? INPUT_PASTE : INPUT_ESCAPE;
 	}
 
 	rd_pending = 0;
-	char ascii = rd_buf[rd_used++];
-	buffer->more = (rd_used < rd_count);
 
-	// Check for stop conditions (newline and EOF)
-	if (ascii == '\n' || ascii == CHAR_EOT) {
-		buffer->eof = (ascii == CHAR_EOT);
-		return INPUT_STOP;
+	// Sequences missing from terminfo are decoded or dropped
+	csi_key key;
+	if (rd_used != rd_count && rd_buf[rd_used & IO_BUF_MASK] == '\033'
+		&& nrl_csi_parse(&io_next_char, &key)) {
+		rd_used += rd_pending;
+		rd_pending = 0;
+		buffer->more = (rd_used != rd_count);
+
+		switch (key.type) {
+		case CSI_KEY_ESCAPE:
+			buffer->escape = key.escape;
+			return INPUT_ESCAPE;
+		case CSI_KEY_CHAR:
+			return classify_char(buffer, key.ascii);
+		default:
+			return INPUT_IGNORED;
+		}
 	}
 
-	// TODO: UTF8 handling
+	rd_pending = 0;
+	char ascii = rd_buf[rd_used++ & IO_BUF_MASK];
+	buffer->more = (rd_used != rd_count);
+
+	return classify_char(buffer, ascii);
+}
+
+bool nrl_io_read_line(int read_fd, vector *line) {
+	// Buffered data belongs to another file
+	if (read_fd != read_file) {
+		rd_count = 0;
+		rd_used = 0;
+	}
+
+	read_file = read_fd;
+	rd_pending = 0;
+
+	while (true) {
+		const char *start = rd_buf + (rd_used & IO_BUF_MASK);
+		uint32_t available = ring_contiguous();
+		const char *newline = memchr(start, '\n', available);
+
+		uint32_t length = (newline == NULL) ? available : newline - start;
+		if (length > 0) {
+			vector_status res
+				= vec_bulk_insert(line, line->count, start, length);
+			assert(res == VECTOR_STATUS_OK);
+		}
 
-	// Check for unprintable control codes
-	if (!parse_ascii_control(ascii, buffer)) {
-		// Character is printable: place it in buffer ourselves
-		buffer->text[0] = ascii;
-		buffer->length = 1;
+		if (newline != NULL) {
+			rd_used += length + 1;
+			return true;
+		}
+		rd_used += length;
+
+		// Buffer exhausted: read in more
+		if (rd_used == rd_count && !ring_fill()) {
+			return false;
+		}
+	}
+}
+
+uint32_t nrl_io_take_input(int read_fd, char *buf, uint32_t size) {
+	if (read_fd != read_file) {
+		return 0;
 	}
 
-	return INPUT_ASCII;
+	uint32_t taken = 0;
+	while (taken < size && rd_used != rd_count) {
+		uint32_t length = ring_contiguous();
+		if (length > size - taken) {
+			length = size - taken;
+		}
+
+		memcpy(buf + taken, rd_buf + (rd_used & IO_BUF_MASK), length);
+		rd_used += length;
+		taken += length;
+	}
+
+	rd_pending = 0;
+	return taken;
 }
 
 bool nrl_io_write(const char *data, uint32_t length) {
@@ -98,9 +237,11 @@ bool nrl_io_write(const char *data, uint32_t length) {
 		}
 	}
 
+	wr_total += length;
+
 	// Too big to fix buffer
 	if (length > IO_BUF_SIZE) {
-		return write(echo_file, data, length) == length;
+		return write_wrapper(data, length);
 	}
 
 	memcpy(wr_buf + wr_count, data, length);
@@ -109,25 +250,57 @@ bool nrl_io_write(const char *data, uint32_t length) {
 	return true;
 }
 
+uint64_t nrl_io_written(void) {
+	return wr_total;
+}
+
 bool nrl_io_write_escape(terminfo_output escape) {
-	const char *as_text = nrl_lookup_output(escape);
+	terminfo_seq as_text = nrl_lookup_output(terminal, escape);
 
 	// Not supported: skip
-	if (as_text == NULL) {
+	if (as_text.data == NULL) {
 		return true;
 	}
 
-	return nrl_io_write(as_text, strlen(as_text));
+	return nrl_io_write(as_text.data, as_text.length);
+}
+
+bool nrl_io_write_move(terminfo_output step, terminfo_output parm,
+					   uint32_t count) {
+	terminfo_seq single = nrl_lookup_output(terminal, step);
+	terminfo_seq counted = nrl_lookup_output(terminal, parm);
+
+	if (count > 1 && counted.data != NULL) {
+		char seq[MOVE_SEQ_SIZE];
+		uint32_t length = format_count(counted, count, seq);
+
+		if (length > 0
+			&& (single.data == NULL || length < single.length * count)) {
+			return nrl_io_write(seq, length);
+		}
+	}
+
+	for (; count > 0; count--) {
+		if (!nrl_io_write_escape(step)) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 bool nrl_io_flush(void) {
 	assert(echo_file != -1);
 
+	STATS_FLUSH();
 	if (wr_count == 0) {
 		return true;
 	}
 
-	if (write(echo_file, wr_buf, wr_count) != wr_count) {
+	PROBE1(flush__start, wr_count);
+	bool res = write_wrapper(wr_buf, wr_count);
+	PROBE1(flush__end, res ? wr_count : 0);
+	if (!res) {
 		return false;
 	}
 
@@ -136,10 +309,32 @@ bool nrl_io_flush(void) {
 }
 
 void nrl_io_wipe_buffers(void) {
-	memset(rd_buf, 0, IO_BUF_SIZE);
+	// Unread input is kept for the next line
+	for (uint32_t pos = rd_count; pos != rd_used + IO_BUF_SIZE; pos++) {
+		rd_buf[pos & IO_BUF_MASK] = 0;
+	}
 	memset(wr_buf, 0, IO_BUF_SIZE);
 }
 
+void nrl_io_redirect(io_source source, io_sink sink) {
+	input_source = source;
+	output_sink = sink;
+
+	// Buffered input came from elsewhere
+	read_file = -1;
+	rd_count = 0;
+	rd_used = 0;
+	rd_pending = 0;
+}
+
+bool nrl_io_redirected(void) {
+	return input_source != NULL;
+}
+
+void nrl_io_tap(io_tap tap) {
+	input_tap = tap;
+}
+
 void nrl_io_echo_state(bool enabled) {
 	echo_enabled = enabled;
 }
@@ -150,44 +345,239 @@ void nrl_io_echo_state(bool enabled) {
  * @return Next character.
  */
 static char io_next_char(void) {
-	// No characters in buffer: read in more
+	// Parse reached the end of the input: read in more after it
+	if (rd_used + rd_pending == rd_count && !ring_fill()) {
+		// Read error: end the input with an eof character
+		ring_end_input();
+	}
+
+	return rd_buf[(rd_used + rd_pending++) & IO_BUF_MASK];
+}
+
+/**
+ * @brief Read more input into the free part of the ring.
+ *
+ * @return true - Input added. \n
+ *         false - Read error or end of file.
+ * @note Buffered input, including a sequence being parsed, is kept.
+ */
+static bool ring_fill(void) {
+	// Start from the beginning when empty, for the largest read
 	if (rd_used == rd_count) {
-		// Reset counters
 		rd_used = 0;
-		rd_pending = 0;
+		rd_count = 0;
+	}
+
+	// Sequences are far shorter than the buffer
+	uint32_t free_space = IO_BUF_SIZE - (rd_count - rd_used);
+	assert(free_space > 0);
+
+	uint32_t start = rd_count & IO_BUF_MASK;
+	uint32_t space = IO_BUF_SIZE - start;
+	if (space > free_space) {
+		space = free_space;
+	}
 
-		ssize_t bytes = read_wrapper(read_file, rd_buf, IO_BUF_SIZE);
+	ssize_t bytes = read_wrapper(read_file, rd_buf + start, space);
+	if (bytes <= 0) {
+		return false;
+	}
+
+	rd_count += bytes;
+	return true;
+}
+
+/**
+ * @brief Add an eof character after the buffered input.
+ */
+static void ring_end_input(void) {
+	if (rd_count - rd_used == IO_BUF_SIZE) {
+		rd_count--;
+	}
+
+	rd_buf[rd_count++ & IO_BUF_MASK] = CHAR_EOT;
+}
+
+/**
+ * @brief Get amount of buffered input stored without wrapping.
+ *
+ * @return Bytes from rd_used to the end of the input or the buffer.
+ */
+static uint32_t ring_contiguous(void) {
+	uint32_t available = rd_count - rd_used;
+	uint32_t to_end = IO_BUF_SIZE - (rd_used & IO_BUF_MASK);
+	return (available < to_end) ? available : to_end;
+}
+
+/**
+ * @brief Compare buffered input to a string.
+ *
+ * @param[in] pos - Ring position to start from.
+ * @param[in] data - String to compare with.
+ * @param[in] length - Amount to compare; must be buffered.
+ * @return Whether the input matches.
+ */
+static bool ring_equals(uint32_t pos, const char *data, uint32_t length) {
+	for (uint32_t i = 0; i < length; i++) {
+		if (rd_buf[(pos + i) & IO_BUF_MASK] != data[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Store a single character of input.
+ *
+ * @param[out] buffer - Buffer for input.
+ * @param[in] ascii - Input character.
+ * @return Type of input saved into buffer.
+ */
+static input_type classify_char(input_buf *buffer, char ascii) {
+	// Check for stop conditions (newline and EOF)
+	if (ascii == '\n' || ascii == CHAR_EOT) {
+		buffer->eof = (ascii == CHAR_EOT);
+		return INPUT_STOP;
+	}
+
+	// TODO: UTF8 handling
 
-		// Read error: place an eof character
-		if (bytes <= 0) {
-			rd_buf[0] = CHAR_EOT;
-			rd_count = 1;
+	buffer->text[0] = ascii;
+	buffer->length = 1;
 
-			return CHAR_EOT;
+	// C0 codes are below 0x20
+	return ((unsigned char)ascii < 0x20 || ascii == 0x7f) ? INPUT_CONTROL
+														 : INPUT_ASCII;
+}
+
+/**
+ * @brief Fill in the count of a parameterized escape sequence.
+ *
+ * @param[in] seq - Escape sequence with a single '%p1%d' parameter.
+ * @param[in] count - Parameter value.
+ * @param[out] out - Output buffer of @ref MOVE_SEQ_SIZE bytes.
+ * @return Formatted length; 0 if the sequence uses other parameter
+ * operations or does not fit.
+ */
+static uint32_t format_count(terminfo_seq seq, uint32_t count, char *out) {
+	static const char param[] = "%p1%d";
+	const uint32_t param_length = sizeof(param) - 1;
+
+	char digits[10];
+	uint32_t digit_count = 0;
+	do {
+		digits[digit_count++] = '0' + count % 10;
+		count /= 10;
+	} while (count > 0);
+
+	uint32_t length = 0;
+	for (uint32_t i = 0; i < seq.length; i++) {
+		if (seq.data[i] != '%') {
+			if (length == MOVE_SEQ_SIZE) {
+				return 0;
+			}
+			out[length++] = seq.data[i];
+			continue;
 		}
 
-		// All good otherwise
-		rd_count = bytes;
+		// Only a single parameter is filled in
+		if (digit_count == 0 || seq.length - i < param_length
+			|| memcmp(seq.data + i, param, param_length) != 0
+			|| MOVE_SEQ_SIZE - length < digit_count) {
+			return 0;
+		}
+		while (digit_count > 0) {
+			out[length++] = digits[--digit_count];
+		}
+		i += param_length - 1;
 	}
 
-	// End of buffer reached, but DFA parse is in progress
-	// Assume that the sequence size is negligible relative to the buffer size
-	if (rd_used + rd_pending == rd_count) {
-		memmove(rd_buf, rd_buf + rd_count, rd_pending);
+	return length;
+}
 
-		rd_count = rd_pending;
-		rd_used = 0;
+/**
+ * @brief Read bracketed paste contents, up to and including the end marker.
+ *
+ * @param[in,out] text - Buffer for pasted text.
+ * @note Stops early if input ends.
+ */
+static void read_paste(vector *text) {
+	terminfo_seq end = nrl_lookup_input(terminal, TII_PASTE_END);
+	text->count = 0;
+
+	while (true) {
+		const char *start = rd_buf + (rd_used & IO_BUF_MASK);
+		const char *limit = start + ring_contiguous();
+
+		// Find end marker, or its beginning at the end of the input
+		const char *marker = start;
+		uint32_t matched = 0;
+		while ((marker = memchr(marker, end.data[0], limit - marker))
+			   != NULL) {
+			uint32_t pos = rd_used + (marker - start);
+			uint32_t left = rd_count - pos;
+			matched = (left < end.length) ? left : end.length;
+			if (ring_equals(pos, end.data, matched)) {
+				break;
+			}
+
+			matched = 0;
+			marker++;
+		}
+
+		uint32_t length = (marker != NULL) ? marker - start : limit - start;
+		append_paste(text, start, length);
+		rd_used += length;
+
+		if (matched == end.length) {
+			rd_used += matched;
+			return;
+		}
+
+		// Input wraps to the start of the buffer
+		if (rd_used + matched != rd_count) {
+			continue;
+		}
 
-		ssize_t bytes = read_wrapper(read_file, rd_buf + rd_count,
-									 IO_BUF_SIZE - rd_count);
-		rd_count += bytes;
+		// Keep partial end marker, then read in more after it
+		if (!ring_fill()) {
+			// Read error: drop the partial marker and end the input
+			rd_used = rd_count;
+			ring_end_input();
+			return;
+		}
 	}
+}
 
-	return rd_buf[rd_used + rd_pending++];
+/**
+ * @brief Add pasted text to the buffer.
+ *
+ * @param[in,out] text - Buffer for pasted text.
+ * @param[in] data - Pasted data.
+ * @param[in] length - Data length.
+ * @note Control characters are replaced with spaces, since the line is
+ * shown on a single row.
+ */
+static void append_paste(vector *text, const char *data, uint32_t length) {
+	if (length == 0) {
+		return;
+	}
+
+	uint32_t from = text->count;
+	vector_status res = vec_bulk_insert(text, from, data, length);
+	assert(res == VECTOR_STATUS_OK);
+
+	char *added = text->data;
+	for (uint32_t i = from; i < text->count; i++) {
+		if ((unsigned char)added[i] < 0x20 || added[i] == 0x7f) {
+			added[i] = ' ';
+		}
+	}
 }
 
 /**
- * @brief Combines preload and reading logic.
+ * @brief Read from the input file.
  *
  * @param[in] fd - Read file descriptor.
  * @param[in] buf - Buffer for data.
@@ -197,44 +587,107 @@ static char io_next_char(void) {
 static ssize_t read_wrapper(int fd, void *buf, size_t count) {
 	assert(read_file != -1);
 
-	if (preload_data != NULL) {
-		uint32_t remaining = strlen(preload_data);
+	ssize_t bytes;
+	if (input_source != NULL) {
+		bytes = input_source(buf, count);
+	} else {
+		bytes = wait_input(fd) ? read(fd, buf, count) : -1;
+	}
+	PROBE2(read, fd, bytes);
+
+	STATS_ADD(read_calls, 1);
+	if (bytes > 0) {
+		STATS_ADD(read_bytes, bytes);
+		STATS_INPUT();
 
-		if (remaining > count) {
-			memcpy(buf, preload_data, count);
-			preload_data += count;
-			return count;
-		} else {
-			memcpy(buf, preload_data, remaining);
-			preload_data = NULL;
-			return remaining;
+		if (input_tap != NULL) {
+			input_tap(buf, bytes);
 		}
 	}
 
-	return read(fd, buf, count);
+	return bytes;
 }
 
 /**
- * @brief Check if the input is a C0 code and if so, populate buffer with a
- * printable representation.
+ * @brief Wait until the read file has input, unless stopped first.
  *
- * @param[in] ascii - ASCII character.
- * @param[out] buffer - Buffer for input.
- * @return true - Character is a C0 code; buffer populated. \n
- *         false - Character is printable.
+ * @param[in] fd - Read file descriptor.
+ * @return true - Input (or an error) is ready to be read. \n
+ *         false - Wait stopped; errno is set to ECANCELED, ETIMEDOUT or EINTR.
  */
-static bool parse_ascii_control(char ascii, input_buf *buffer) {
-	// C0 codes are below 0x20
-	if (ascii >= 0x20) {
-		return false;
+static bool wait_input(int fd) {
+	if (wait_cancel < 0 && wait_deadline == 0 && notify_file < 0) {
+		return true;
+	}
+
+	struct pollfd fds[3] = {
+		{ .fd = fd, .events = POLLIN },
+		{ .fd = wait_cancel, .events = POLLIN },
+		{ .fd = notify_file, .events = POLLIN },
+	};
+
+	while (true) {
+		// Negative timeout waits indefinitely
+		int timeout = -1;
+		if (wait_deadline > 0) {
+			uint64_t now = monotonic_ns();
+			uint64_t left = (wait_deadline > now) ? wait_deadline - now : 0;
+			uint64_t left_ms = (left + 999999) / 1000000;
+			timeout = (left_ms < INT_MAX) ? (int)left_ms : INT_MAX;
+		}
+
+		// Negative descriptors are skipped by poll
+		int ready = poll(fds, 3, timeout);
+		if (ready < 0) {
+			return false;
+		}
+
+		if (fds[1].revents != 0) {
+			errno = ECANCELED;
+			return false;
+		}
+		if (ready == 0) {
+			errno = ETIMEDOUT;
+			return false;
+		}
+
+		// Notifications are handled before input
+		if (fds[2].revents != 0) {
+			notify_handler();
+		}
+		if (fds[0].revents != 0) {
+			return true;
+		}
 	}
+}
 
-	// Generally how C0 codes are represented
-	buffer->text[0] = '^';
-	buffer->text[1] = ascii + 0x40;
-	buffer->length = 2;
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return Clock value in nanoseconds.
+ */
+static uint64_t monotonic_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
 
-	return true;
+/**
+ * @brief Write to the echo file.
+ *
+ * @param[in] data - Data buffer.
+ * @param[in] length - Data length.
+ * @return Whether all data was written.
+ */
+static bool write_wrapper(const char *data, uint32_t length) {
+	STATS_ADD(write_calls, 1);
+	STATS_ADD(write_bytes, length);
+
+	if (output_sink != NULL) {
+		return output_sink(data, length);
+	}
+
+	return write(echo_file, data, length) == length;
 }
 
 // @endcond
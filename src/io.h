@@ -11,6 +11,9 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <sys/types.h>
+
+#include <c-utils/vector.h>
 
 #include "terminfo.h"
 
@@ -29,6 +32,15 @@
  * @var input_type::NRL_INPUT_ESCAPE
  * Valid escape code received.
  *
+ * @var input_type::NRL_INPUT_CONTROL
+ * C0 control character or DEL received.
+ *
+ * @var input_type::NRL_INPUT_PASTE
+ * Bracketed paste received.
+ *
+ * @var input_type::NRL_INPUT_IGNORED
+ * Unsupported control sequence received and dropped.
+ *
  * @var input_type::NRL_INPUT_STOP
  * End condition received.
  */
@@ -36,6 +48,9 @@ typedef enum {
 	INPUT_ASCII,
 	INPUT_UTF8,
 	INPUT_ESCAPE,
+	INPUT_CONTROL,
+	INPUT_PASTE,
+	INPUT_IGNORED,
 	INPUT_STOP,
 } input_type;
 
@@ -52,12 +67,16 @@ typedef enum {
  * Used with @ref NRL_INPUT_STOP.
  *
  * @var input_buf::text.
- * Buffer for a text sequence.
+ * Buffer for a text sequence or a control character.
  * Used with other input types.
  *
  * @var input_buf::length
  * Length of data in the text array.
  *
+ * @var input_buf::paste
+ * Buffer for pasted text, provided by the caller; replaced on each paste.
+ * Used with @ref NRL_INPUT_PASTE.
+ *
  * @var input_buf::more
  * Flag for whether there is more input in the buffer currently.
  */
@@ -66,17 +85,72 @@ typedef struct {
 	bool eof;
 	char text[SINGLE_BUF_SIZE];
 	uint32_t length;
+	vector *paste;
 	bool more;
 } input_buf;
 
+/**
+ * @typedef io_source
+ * Replacement for reads from the read file; same semantics as read.
+ */
+typedef ssize_t (*io_source)(void *buf, size_t count);
+
+/**
+ * @typedef io_sink
+ * Replacement for writes to the echo file; returns whether write succeeded.
+ */
+typedef bool (*io_sink)(const char *data, uint32_t length);
+
+/**
+ * @typedef io_tap
+ * Observer of every chunk of input read.
+ */
+typedef void (*io_tap)(const char *data, uint32_t length);
+
+/**
+ * @typedef io_notify
+ * Called while waiting for input, when the notification file is readable.
+ */
+typedef void (*io_notify)(void);
+
 /**
  * @brief Initialize buffers and set files.
  *
  * @param[in] read_fd - Read file descriptor.
  * @param[in] echo_fd - Echo file descriptor.
- * @param[in] preload - Preload value.
+ * @note Unread input is kept if the read file has not changed.
+ */
+void nrl_io_init(int read_fd, int echo_fd);
+
+/**
+ * @brief Set terminal capabilities used for input and output.
+ *
+ * @param[in] capabilities - Terminal capabilities; must stay referenced
+ * while in use.
  */
-void nrl_io_init(int read_fd, int echo_fd, const char *preload);
+void nrl_io_terminal(const terminfo_snapshot *capabilities);
+
+/**
+ * @brief Set conditions that stop waiting for input.
+ *
+ * Reads that would block fail with ECANCELED once cancel_fd is readable and
+ * with ETIMEDOUT after the timeout.
+ *
+ * @param[in] cancel_fd - File descriptor to watch; -1 for none.
+ * @param[in] timeout_ms - Time limit from now in milliseconds; 0 for none.
+ * @note Not used for redirected input.
+ */
+void nrl_io_limit(int cancel_fd, uint32_t timeout_ms);
+
+/**
+ * @brief Set a file to watch while waiting for input.
+ *
+ * @param[in] fd - File descriptor; -1 for none.
+ * @param[in] handler - Function called when fd is readable; it must make fd
+ * unreadable again.
+ * @note Not used for redirected input.
+ */
+void nrl_io_notify(int fd, io_notify handler);
 
 /**
  * @brief Read data from input.
@@ -86,6 +160,27 @@ void nrl_io_init(int read_fd, int echo_fd, const char *preload);
  */
 input_type nrl_io_read(input_buf *buffer);
 
+/**
+ * @brief Read a whole line without any processing.
+ *
+ * @param[in] read_fd - Read file descriptor.
+ * @param[in,out] line - Buffer to append the line to, without the newline.
+ * @return true - Newline reached. \n
+ *         false - End of file or read error reached.
+ * @note Unused input is kept for the next call with the same file.
+ */
+bool nrl_io_read_line(int read_fd, vector *line);
+
+/**
+ * @brief Move unread input out of the input buffer.
+ *
+ * @param[in] read_fd - Read file descriptor.
+ * @param[out] buf - Buffer for the input.
+ * @param[in] size - Buffer size.
+ * @return Amount of bytes moved; 0 if the input belongs to another file.
+ */
+uint32_t nrl_io_take_input(int read_fd, char *buf, uint32_t size);
+
 /**
  * @brief Write data to output (with buffering).
  *
@@ -96,6 +191,14 @@ input_type nrl_io_read(input_buf *buffer);
  */
 bool nrl_io_write(const char *data, uint32_t length);
 
+/**
+ * @brief Get total amount of bytes passed to the output.
+ *
+ * @return Byte count since the library was loaded.
+ * @note Differences between calls measure output of an operation.
+ */
+uint64_t nrl_io_written(void);
+
 /**
  * @brief Send escape sequence to the output.
  *
@@ -103,6 +206,18 @@ bool nrl_io_write(const char *data, uint32_t length);
  */
 bool nrl_io_write_escape(terminfo_output escape);
 
+/**
+ * @brief Send cursor movement escape sequences to the output.
+ *
+ * @param[in] step - Escape sequence identifier for a single step.
+ * @param[in] parm - Escape sequence identifier taking a step count.
+ * @param[in] count - Amount of steps.
+ * @return Whether write succeeded.
+ * @note Uses whichever of @p parm and repeated @p step is shorter.
+ */
+bool nrl_io_write_move(terminfo_output step, terminfo_output parm,
+					   uint32_t count);
+
 /**
  * @brief Send buffered data to echo file.
  *
@@ -112,9 +227,34 @@ bool nrl_io_flush(void);
 
 /**
  * @brief Zero all buffer data (for secure applications).
+ *
+ * @note Unread input is kept.
  */
 void nrl_io_wipe_buffers(void);
 
+/**
+ * @brief Replace the files with functions, or restore them.
+ *
+ * @param[in] source - Input source; NULL to read from the read file.
+ * @param[in] sink - Output sink; NULL to write to the echo file.
+ * @note Buffered input is dropped.
+ */
+void nrl_io_redirect(io_source source, io_sink sink);
+
+/**
+ * @brief Check if input is redirected away from the read file.
+ *
+ * @return Whether an input source is set.
+ */
+bool nrl_io_redirected(void);
+
+/**
+ * @brief Set the input observer.
+ *
+ * @param[in] tap - Function called with each chunk read; NULL to remove.
+ */
+void nrl_io_tap(io_tap tap);
+
 /**
  * @brief Enables or disabled echo.
  *
@@ -0,0 +1,81 @@
+/**
+ * @cond internal
+ * @file keymap.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Key bindings.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "keymap.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "manip.h"
+#include "nanorl.h"
+#include "probes.h"
+#include "terminfo.h"
+
+/**
+ * @var keymap
+ * Functions bound to each key, indexed directly by key. Emacs-style bindings
+ * are loaded by default.
+ */
+static nrl_binding keymap[KEYMAP_SIZE] = {
+	[NRL_KEY_CTRL('A')] = &nrl_manip_home,
+	[NRL_KEY_CTRL('B')] = &nrl_manip_left,
+	[NRL_KEY_CTRL('E')] = &nrl_manip_end,
+	[NRL_KEY_CTRL('F')] = &nrl_manip_right,
+	[NRL_KEY_CTRL('H')] = &nrl_manip_backspace,
+	[NRL_KEY_CTRL('K')] = &nrl_manip_kill_to_end,
+	[NRL_KEY_CTRL('U')] = &nrl_manip_kill_to_start,
+	[NRL_KEY_CTRL('W')] = &nrl_manip_kill_word_left,
+	[KEYMAP_DEL] = &nrl_manip_backspace,
+
+	[KEYMAP_ESCAPE(TII_KEY_LEFT)] = &nrl_manip_left,
+	[KEYMAP_ESCAPE(TII_KEY_RIGHT)] = &nrl_manip_right,
+	[KEYMAP_ESCAPE(TII_KEY_BACKSPACE)] = &nrl_manip_backspace,
+	[KEYMAP_ESCAPE(TII_KEY_HOME)] = &nrl_manip_home,
+	[KEYMAP_ESCAPE(TII_KEY_END)] = &nrl_manip_end,
+	[KEYMAP_ESCAPE(TII_KEY_DELETE)] = &nrl_manip_delete,
+	[KEYMAP_ESCAPE(TII_KEY_CTRL_LEFT)] = &nrl_manip_word_left,
+	[KEYMAP_ESCAPE(TII_KEY_CTRL_RIGHT)] = &nrl_manip_word_right,
+	[KEYMAP_ESCAPE(TII_KEY_ALT_LEFT)] = &nrl_manip_word_left,
+	[KEYMAP_ESCAPE(TII_KEY_ALT_RIGHT)] = &nrl_manip_word_right,
+	[KEYMAP_ESCAPE(TII_KEY_CTRL_DELETE)] = &nrl_manip_kill_word_right,
+};
+
+bool nrl_bind_key(uint32_t key, nrl_binding binding) {
+	// Slots between the escape keys and DEL are never looked up
+	if (key >= KEYMAP_SIZE
+		|| (key >= KEYMAP_ESCAPE(TII_COUNT) && key < KEYMAP_DEL)) {
+		return false;
+	}
+
+	// Input stop conditions
+	if (key == NRL_KEY_CTRL('J') || key == NRL_KEY_CTRL('D')) {
+		return false;
+	}
+
+	// Paste markers are handled before the keymap
+	if (key == KEYMAP_ESCAPE(TII_PASTE_START)
+		|| key == KEYMAP_ESCAPE(TII_PASTE_END)) {
+		return false;
+	}
+
+	keymap[key] = binding;
+	return true;
+}
+
+void nrl_keymap_eval(line_data *line, uint32_t key) {
+	if (key < KEYMAP_SIZE && keymap[key] != NULL) {
+		PROBE2(manip__entry, key, line->cursor);
+		keymap[key](line);
+		PROBE2(manip__return, key, line->cursor);
+	}
+}
+
+// @endcond
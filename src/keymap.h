@@ -0,0 +1,49 @@
+/**
+ * @cond internal
+ * @file keymap.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Key bindings.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "manip.h"
+#include "terminfo.h"
+
+/**
+ * @def KEYMAP_CONTROL_COUNT
+ * Amount of C0 control characters, which start the keymap.
+ */
+#define KEYMAP_CONTROL_COUNT 0x20
+
+/**
+ * @def KEYMAP_ESCAPE
+ * Keymap index for a terminfo input sequence.
+ */
+#define KEYMAP_ESCAPE(id) (KEYMAP_CONTROL_COUNT + (id))
+
+/**
+ * @def KEYMAP_DEL
+ * Keymap index for the DEL character; input sequences must end before it.
+ */
+#define KEYMAP_DEL 0x7f
+
+/**
+ * @def KEYMAP_SIZE
+ * Total entries in the keymap.
+ */
+#define KEYMAP_SIZE (KEYMAP_DEL + 1)
+
+/**
+ * @brief Run function bound to a key.
+ *
+ * @param[in,out] line - Line data object.
+ * @param[in] key - Keymap index.
+ */
+void nrl_keymap_eval(line_data *line, uint32_t key);
+
+// @endcond
@@ -0,0 +1,215 @@
+/**
+ * @cond internal
+ * @file lines.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Batch line reading.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "nanorl.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "stats.h"
+
+/**
+ * @def LINES_BUF_SIZE
+ * Initial size of the read buffer.
+ */
+#define LINES_BUF_SIZE 65536
+
+static int lines_file = -1;
+
+/**
+ * Mapped file contents, for regular files.
+ */
+static const char *map_data = NULL;
+static size_t map_size = 0;
+static off_t map_offset = 0;
+
+/**
+ * Read buffer, for other files. Grows to fit the longest line.
+ */
+static char *buf_data = NULL;
+static size_t buf_size = 0;
+
+/**
+ * Start of unreturned data, in the mapping or the buffer.
+ */
+static size_t data_start = 0;
+
+/**
+ * End of valid data, in the mapping or the buffer.
+ */
+static size_t data_end = 0;
+
+/**
+ * Position up to which the current line has been searched for newlines.
+ */
+static size_t scan_pos = 0;
+
+static bool fill_buffer(void);
+
+bool nrl_lines_open(int fd) {
+	if (lines_file != -1) {
+		nrl_lines_close();
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) < 0) {
+		return false;
+	}
+
+	buf_data = malloc(LINES_BUF_SIZE);
+	if (buf_data == NULL) {
+		return false;
+	}
+	buf_size = LINES_BUF_SIZE;
+
+	lines_file = fd;
+	data_start = 0;
+	scan_pos = 0;
+
+	// Input buffered by earlier nanorl calls comes first
+	data_end = nrl_io_take_input(fd, buf_data, buf_size);
+	if (data_end > 0) {
+		return true;
+	}
+
+	// Regular files are read straight from the page cache
+	off_t offset = lseek(fd, 0, SEEK_CUR);
+	if (S_ISREG(info.st_mode) && offset >= 0 && offset < info.st_size) {
+		// Mappings start on a page boundary
+		off_t start = offset - offset % sysconf(_SC_PAGESIZE);
+		size_t size = info.st_size - start;
+
+		void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, start);
+		if (map != MAP_FAILED) {
+			posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+			free(buf_data);
+			buf_data = NULL;
+			buf_size = 0;
+
+			map_data = map;
+			map_size = size;
+			map_offset = start;
+			data_start = offset - start;
+			scan_pos = data_start;
+			data_end = map_size;
+		}
+	}
+
+	return true;
+}
+
+nrl_error nrl_lines_next(const char **line, uint32_t *length) {
+	if (lines_file == -1) {
+		return NRL_ERROR_ARG;
+	}
+
+	const char *data = (map_data != NULL) ? map_data : buf_data;
+	errno = 0;
+
+	while (true) {
+		const char *newline
+			= memchr(data + scan_pos, '\n', data_end - scan_pos);
+
+		if (newline != NULL) {
+			*line = data + data_start;
+			*length = newline - *line;
+
+			data_start = newline - data + 1;
+			scan_pos = data_start;
+			return NRL_ERROR_OK;
+		}
+		scan_pos = data_end;
+
+		if (map_data != NULL || !fill_buffer()) {
+			break;
+		}
+		data = buf_data;
+	}
+
+	// Read error
+	if (errno != 0) {
+		return (errno == EINTR) ? NRL_ERROR_INTERRUPT : NRL_ERROR_SYSTEM;
+	}
+
+	// Last line without a newline
+	if (data_start < data_end) {
+		*line = data + data_start;
+		*length = data_end - data_start;
+
+		data_start = data_end;
+		return NRL_ERROR_OK;
+	}
+
+	return NRL_ERROR_EOF;
+}
+
+void nrl_lines_close(void) {
+	// Mapped reads leave the file position alone
+	if (map_data != NULL) {
+		lseek(lines_file, map_offset + data_start, SEEK_SET);
+		munmap((void *)map_data, map_size);
+	}
+	free(buf_data);
+
+	map_data = NULL;
+	map_size = 0;
+	map_offset = 0;
+	buf_data = NULL;
+	buf_size = 0;
+	lines_file = -1;
+}
+
+/**
+ * @brief Read more data into the buffer, keeping the current line.
+ *
+ * @return true - Data read. \n
+ *         false - End of file or error; errno is set on error.
+ */
+static bool fill_buffer(void) {
+	// Move current line to the front
+	if (data_start > 0) {
+		memmove(buf_data, buf_data + data_start, data_end - data_start);
+		data_end -= data_start;
+		scan_pos -= data_start;
+		data_start = 0;
+	}
+
+	// Line fills the buffer: grow it
+	if (data_end == buf_size) {
+		char *grown = realloc(buf_data, buf_size * 2);
+		if (grown == NULL) {
+			return false;
+		}
+
+		buf_data = grown;
+		buf_size *= 2;
+	}
+
+	errno = 0;
+	ssize_t bytes = read(lines_file, buf_data + data_end, buf_size - data_end);
+	STATS_ADD(read_calls, 1);
+	if (bytes <= 0) {
+		return false;
+	}
+	STATS_ADD(read_bytes, bytes);
+
+	data_end += bytes;
+	return true;
+}
+
+// @endcond
@@ -12,108 +12,230 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <c-utils/vector-ext.h>
 #include <c-utils/vector.h>
 
-#include "io.h"
-#include "terminfo.h"
-
-typedef struct {
-	terminfo_input value;
-	void (*func)(line_data *);
-} escape_manip;
-
-static void escape_backspace(line_data *line);
-static void escape_left(line_data *line);
-static void escape_right(line_data *line);
-static void escape_delete(line_data *line);
-static void escape_home(line_data *line);
-static void escape_end(line_data *line);
-
-static const escape_manip esc_manips[] = {
-	{ TII_KEY_BACKSPACE, &escape_backspace },
-	{ TII_KEY_LEFT, &escape_left },
-	{ TII_KEY_RIGHT, &escape_right },
-	{ TII_KEY_DELETE, &escape_delete },
-	{ TII_KEY_HOME, &escape_home },
-	{ TII_KEY_END, &escape_end },
-	{ 0, NULL },
-};
+#include "nanorl.h"
+#include "probes.h"
+#include "stats.h"
+
+static void mark_dirty(line_data *line, uint32_t from);
+static void erase_range(line_data *line, uint32_t from, uint32_t to);
+static uint32_t word_start(const line_data *line);
+static uint32_t word_end(const line_data *line);
 
 void nrl_manip_insert_ascii(line_data *line,
 							const char *data,
 							uint32_t length) {
+	PROBE2(insert__entry, line->cursor, length);
+
+#if STATS == 1
+	const void *old_data = line->buffer.data;
+#endif // STATS
+
 	vector_status res
 		= vec_bulk_insert(&line->buffer, line->cursor, data, length);
 	assert(res == VECTOR_STATUS_OK);
 
-	line->cursor += length;
-	line->dirty = true;
-}
+#if STATS == 1
+	if (line->buffer.data != old_data) {
+		STATS_ADD(line_reallocs, 1);
+	}
+#endif // STATS
 
-void nrl_manip_eval_escape(line_data *line, terminfo_input escape) {
-	const escape_manip *manip = esc_manips;
-	while (manip->func != NULL) {
-		if (manip->value == escape) {
-			manip->func(line);
-			break;
-		}
+	mark_dirty(line, line->cursor);
+	line->cursor += length;
 
-		manip++;
-	}
+	PROBE2(insert__return, line->cursor, line->buffer.count);
 }
 
-static void escape_backspace(line_data *line) {
+void nrl_manip_backspace(line_data *line) {
 	if (line->cursor > 0) {
 		line->cursor--;
-		escape_delete(line);
+		nrl_manip_delete(line);
 	}
 }
 
-static void escape_left(line_data *line) {
+void nrl_manip_left(line_data *line) {
 	if (line->cursor > 0) {
 		line->cursor--;
-		line->render_cursor--;
-		nrl_io_write_escape(TIO_CURSOR_LEFT);
 	}
 }
 
-static void escape_right(line_data *line) {
+void nrl_manip_right(line_data *line) {
 	if (line->cursor < line->buffer.count) {
 		line->cursor++;
-		line->render_cursor++;
-		nrl_io_write_escape(TIO_CURSOR_RIGHT);
+		return;
+	}
+
+	// Accept suggestion
+	if (line->suggestion != NULL) {
+		nrl_manip_insert_ascii(line, line->suggestion,
+							   line->suggestion_length);
 	}
 }
 
-static void escape_delete(line_data *line) {
+void nrl_manip_delete(line_data *line) {
 	// TODO: utf8 handling
 	// If cursor is at count, there is no character under the cursor
 	if (line->cursor < line->buffer.count) {
 		vector_status res = vec_erase(&line->buffer, line->cursor, NULL);
 		assert(res == VECTOR_STATUS_OK);
 
-		line->dirty = true;
+		mark_dirty(line, line->cursor);
 	}
 }
 
-static void escape_home(line_data *line) {
-	for (uint32_t i = 0; i < line->cursor; i++) {
-		nrl_io_write_escape(TIO_CURSOR_LEFT);
-	}
+void nrl_manip_home(line_data *line) {
+	line->cursor = 0;
+}
 
+void nrl_manip_end(line_data *line) {
+	line->cursor = line->buffer.count;
+}
+
+void nrl_manip_kill_to_start(line_data *line) {
+	erase_range(line, 0, line->cursor);
 	line->cursor = 0;
-	line->render_cursor = 0;
 }
 
-static void escape_end(line_data *line) {
-	for (uint32_t i = line->cursor; i < line->buffer.count; i++) {
-		nrl_io_write_escape(TIO_CURSOR_RIGHT);
+void nrl_manip_kill_to_end(line_data *line) {
+	erase_range(line, line->cursor, line->buffer.count);
+}
+
+void nrl_manip_kill_word_left(line_data *line) {
+	uint32_t from = word_start(line);
+	erase_range(line, from, line->cursor);
+	line->cursor = from;
+}
+
+void nrl_manip_kill_word_right(line_data *line) {
+	erase_range(line, line->cursor, word_end(line));
+}
+
+void nrl_manip_word_left(line_data *line) {
+	line->cursor = word_start(line);
+}
+
+void nrl_manip_word_right(line_data *line) {
+	line->cursor = word_end(line);
+}
+
+/** Public line API */
+
+const char *nrl_line_data(const nrl_line *line, uint32_t *length) {
+	*length = line->buffer.count;
+	return line->buffer.data;
+}
+
+uint32_t nrl_line_cursor(const nrl_line *line) {
+	return line->cursor;
+}
+
+void nrl_line_set_cursor(nrl_line *line, uint32_t cursor) {
+	line->cursor
+		= (cursor < line->buffer.count) ? cursor : line->buffer.count;
+}
+
+void nrl_line_insert(nrl_line *line, const char *text, uint32_t length) {
+	nrl_manip_insert_ascii(line, text, length);
+}
+
+void nrl_line_erase(nrl_line *line, uint32_t from, uint32_t to) {
+	if (to > line->buffer.count) {
+		to = line->buffer.count;
+	}
+	if (from >= to) {
+		return;
 	}
 
-	line->cursor = line->buffer.count;
-	line->render_cursor = line->buffer.count;
+	erase_range(line, from, to);
+
+	// Keep cursor on the same character
+	if (line->cursor >= to) {
+		line->cursor -= to - from;
+	} else if (line->cursor > from) {
+		line->cursor = from;
+	}
+}
+
+/**
+ * @brief Mark line as modified.
+ *
+ * @param[in,out] line - Line data object.
+ * @param[in] from - First modified character.
+ */
+static void mark_dirty(line_data *line, uint32_t from) {
+	if (!line->dirty || from < line->dirty_from) {
+		line->dirty_from = from;
+	}
+
+	line->dirty = true;
+}
+
+/**
+ * @brief Remove a range of characters with a single move.
+ *
+ * @param[in,out] line - Line data object.
+ * @param[in] from - First character to remove.
+ * @param[in] to - Character to stop at (exclusive).
+ * @note Does not update the cursor.
+ */
+static void erase_range(line_data *line, uint32_t from, uint32_t to) {
+	if (from >= to) {
+		return;
+	}
+
+	char *data = line->buffer.data;
+	memmove(data + from, data + to, line->buffer.count - to);
+	line->buffer.count -= to - from;
+
+	mark_dirty(line, from);
+}
+
+/**
+ * @brief Find the start of the word before the cursor.
+ *
+ * @param[in] line - Line data object.
+ * @return Position after skipping whitespace, then the word before it.
+ */
+static uint32_t word_start(const line_data *line) {
+	const char *data = line->buffer.data;
+
+	uint32_t pos = line->cursor;
+	while (pos > 0 && data[pos - 1] == ' ') {
+		pos--;
+	}
+	while (pos > 0 && data[pos - 1] != ' ') {
+		pos--;
+	}
+
+	return pos;
+}
+
+/**
+ * @brief Find the end of the word after the cursor.
+ *
+ * @param[in] line - Line data object.
+ * @return Position after skipping whitespace, then the word after it.
+ */
+static uint32_t word_end(const line_data *line) {
+	const char *data = line->buffer.data;
+	uint32_t count = line->buffer.count;
+
+	uint32_t pos = line->cursor;
+	while (pos < count && data[pos] == ' ') {
+		pos++;
+	}
+	if (pos == count) {
+		return count;
+	}
+
+	// Long words are scanned by memchr rather than a byte at a time
+	const char *space = memchr(data + pos, ' ', count - pos);
+	return (space != NULL) ? (uint32_t)(space - data) : count;
 }
 
 // @endcond
@@ -14,7 +14,7 @@
 
 #include <c-utils/vector.h>
 
-#include "terminfo.h"
+#include "nanorl.h"
 
 /**
  * @struct line_data
@@ -27,16 +27,36 @@
  * Current virtual cursor placement.
  *
  * @var line_data::render_cursor
- * Current real cursor placement.
+ * Current real cursor placement, relative to the first visible character.
+ *
+ * @var line_data::render_count
+ * Amount of characters currently printed on the screen.
+ *
+ * @var line_data::scroll
+ * Index of the first visible character.
  *
  * @var line_data::dirty
  * Set when line is modified: memory and screen are out of sync.
+ *
+ * @var line_data::dirty_from
+ * First modified character, valid while the line is dirty.
+ *
+ * @var line_data::suggestion
+ * Currently shown history suggestion; NULL if none.
+ *
+ * @var line_data::suggestion_length
+ * Length of the suggestion.
  */
-typedef struct {
+typedef struct nrl_line {
 	vector buffer;
 	uint32_t cursor;
 	uint32_t render_cursor;
+	uint32_t render_count;
+	uint32_t scroll;
 	bool dirty;
+	uint32_t dirty_from;
+	const char *suggestion;
+	uint32_t suggestion_length;
 } line_data;
 
 /**
@@ -49,11 +69,88 @@ typedef struct {
 void nrl_manip_insert_ascii(line_data *line, const char *data, uint32_t length);
 
 /**
- * @brief Evaluate an escape sequence.
+ * @brief Delete character before the cursor.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_backspace(line_data *line);
+
+/**
+ * @brief Move cursor one character left.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_left(line_data *line);
+
+/**
+ * @brief Move cursor one character right, or accept the suggestion at the end
+ * of the line.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_right(line_data *line);
+
+/**
+ * @brief Delete character under the cursor.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_delete(line_data *line);
+
+/**
+ * @brief Move cursor to the start of the line.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_home(line_data *line);
+
+/**
+ * @brief Move cursor to the end of the line.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_end(line_data *line);
+
+/**
+ * @brief Delete everything before the cursor.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_kill_to_start(line_data *line);
+
+/**
+ * @brief Delete everything from the cursor onwards.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_kill_to_end(line_data *line);
+
+/**
+ * @brief Delete the word before the cursor.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_kill_word_left(line_data *line);
+
+/**
+ * @brief Delete the word after the cursor.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_kill_word_right(line_data *line);
+
+/**
+ * @brief Move cursor to the start of the word before it.
+ *
+ * @param[in,out] line - Line data object.
+ */
+void nrl_manip_word_left(line_data *line);
+
+/**
+ * @brief Move cursor to the end of the word after it.
  *
  * @param[in,out] line - Line data object.
- * @param[in] escape - Escape sequence identifier.
  */
-void nrl_manip_eval_escape(line_data *line, terminfo_input escape);
+void nrl_manip_word_right(line_data *line);
 
 // @endcond
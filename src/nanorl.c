@@ -21,11 +21,19 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include <c-utils/vector-ext.h>
 #include <c-utils/vector.h>
 
+#include "cancel.h"
 #include "dfa.h"
+#include "highlight.h"
+#include "history.h"
 #include "io.h"
+#include "keymap.h"
 #include "manip.h"
+#include "print.h"
+#include "render.h"
+#include "stats.h"
 #include "terminfo.h"
 
 /**
@@ -57,6 +65,26 @@ static struct sigaction old_sigquit_sa;
  */
 static int intr_code;
 
+/**
+ * Whether a session is active.
+ */
+static bool session_active = false;
+
+/**
+ * Configuration the active session was started with.
+ */
+static nrl_config session_conf;
+
+/**
+ * Line being edited, while waiting for input.
+ */
+static line_data *active_line = NULL;
+
+/**
+ * Terminal capabilities, referenced while the terminal is set up.
+ */
+static const terminfo_snapshot *session_terminal = NULL;
+
 /**
  * Default nanorl configuration.
  */
@@ -67,6 +95,14 @@ static const nrl_config default_conf = {
 	.preload = NULL,
 	.assume_smkx = false,
 	.echo_mode = NRL_ECHO_ON,
+	.layout_mode = NRL_LAYOUT_WRAP,
+	.scroll_step = 0,
+	.highlighter = NULL,
+	.suggest = false,
+	.continuation = NULL,
+	.continuation_prompt = NULL,
+	.cancel = NULL,
+	.timeout_ms = 0,
 };
 
 #define safe_assign(var_ptr, val)                                              \
@@ -76,6 +112,20 @@ static const nrl_config default_conf = {
 
 static void sig_handle(int code);
 static bool check_args(const nrl_config *config);
+static void print_queued(void);
+static bool read_stopped(nrl_error *error);
+static bool next_row(const nrl_config *config,
+					 line_data *line,
+					 vector *rows,
+					 uint64_t *state,
+					 const input_buf *buf);
+static char *read_plain(const nrl_config *config, nrl_error *error);
+static bool session_init(const nrl_config *config);
+static bool session_deinit(const nrl_config *config);
+static bool session_restore(const nrl_config *config);
+static bool terminal_init(const nrl_config *config);
+static bool terminal_deinit(const nrl_config *config);
+static bool paste_supported(void);
 static bool init(const nrl_config *config);
 static bool deinit(const nrl_config *config);
 
@@ -86,6 +136,25 @@ char *nanorl(const nrl_config *config, nrl_error *error) {
 		safe_assign(error, NRL_ERROR_ARG);
 		return NULL;
 	}
+
+	// Limits apply to the whole call
+	nrl_io_limit(nrl_cancel_fd(config->cancel), config->timeout_ms);
+
+	// Pick up entries from other processes
+	nrl_history_sync();
+
+	// Not interactive: no editing is possible
+	if (!isatty(config->read_file) && !nrl_io_redirected()) {
+		return read_plain(config, error);
+	}
+
+	// Session terminal can't be changed
+	if (session_active && (config->read_file != session_conf.read_file
+						   || config->echo_file != session_conf.echo_file)) {
+		safe_assign(error, NRL_ERROR_ARG);
+		return NULL;
+	}
+
 	if (!init(config)) {
 		safe_assign(error, NRL_ERROR_SYSTEM);
 		return NULL;
@@ -95,59 +164,90 @@ char *nanorl(const nrl_config *config, nrl_error *error) {
 		.buffer = vec_init(sizeof(char)),
 		.cursor = 0,
 		.render_cursor = 0,
+		.render_count = 0,
+		.scroll = 0,
 		.dirty = false,
+		.dirty_from = 0,
+		.suggestion = NULL,
+		.suggestion_length = 0,
 	};
 
+	// Preload is shown before any input
+	if (config->preload != NULL) {
+		nrl_manip_insert_ascii(&line, config->preload,
+							   strlen(config->preload));
+		nrl_render(&line);
+		nrl_io_flush();
+	}
+
+	// Messages are printed above the line while waiting
+	active_line = &line;
+	nrl_io_notify(nrl_print_init(), &print_queued);
+
+	vector paste = vec_init(sizeof(char));
+
+	// Finished rows of multi-line input
+	vector rows = vec_init(sizeof(char));
+	uint64_t rows_state = 0;
+
 	input_type read_res;
 	input_buf read_buf;
-	while ((read_res = nrl_io_read(&read_buf)) != INPUT_STOP) {
-		uint32_t rendered_count = line.buffer.count;
-
+	read_buf.paste = &paste;
+	while ((read_res = nrl_io_read(&read_buf)) != INPUT_STOP
+		   || next_row(config, &line, &rows, &rows_state, &read_buf)) {
 		switch (read_res) {
 		case INPUT_ASCII:
 			nrl_manip_insert_ascii(&line, read_buf.text, read_buf.length);
 			break;
+		case INPUT_PASTE:
+			if (paste.count > 0) {
+				nrl_manip_insert_ascii(&line, paste.data, paste.count);
+			}
+			break;
 		case INPUT_ESCAPE:
-			nrl_manip_eval_escape(&line, read_buf.escape);
+			nrl_keymap_eval(&line, KEYMAP_ESCAPE(read_buf.escape));
+			break;
+		case INPUT_CONTROL:
+			nrl_keymap_eval(&line, read_buf.text[0]);
 			break;
 		default:
 			break;
 		}
 
-		// Perform a full re-render
-		if (!read_buf.more && line.dirty) {
-			// Move cursor to the beginning
-			for (uint32_t i = 0; i < line.render_cursor; i++) {
-				nrl_io_write_escape(TIO_CURSOR_LEFT);
-			}
+		// Render once the available input is processed
+		if (!read_buf.more) {
+			nrl_render(&line);
+		} else {
+			STATS_ADD(renders_skipped, 1);
+		}
 
-			// Print line data
-			if (config->echo_mode == NRL_ECHO_OBSCURED) {
-				for (uint32_t i = 0; i < line.buffer.count; i++) {
-					nrl_io_write("*", 1);
-				}
-			} else {
-				nrl_io_write(line.buffer.data, line.buffer.count);
-			}
-			uint32_t printed_count = line.buffer.count;
+		nrl_io_flush();
+	}
 
-			// Account for erased characters
-			for (uint32_t i = line.buffer.count; i < rendered_count; i++) {
-				nrl_io_write(" ", 1);
-				printed_count++;
-			}
+	nrl_io_notify(-1, NULL);
+	active_line = NULL;
 
-			// Move cursor to correct location
-			for (uint32_t i = printed_count; i > line.cursor; i--) {
-				nrl_io_write_escape(TIO_CURSOR_LEFT);
-			}
+	nrl_render_finish(&line);
+	nrl_io_flush();
+	nrl_highlight_deinit();
 
-			line.dirty = false;
-			line.render_cursor = line.cursor;
-		}
+	// Pasted text is also secure data
+	if (config->echo_mode != NRL_ECHO_ON && paste.count > 0) {
+		memset(paste.data, 0, paste.count);
+	}
+	vec_deinit(&paste);
 
-		nrl_io_flush();
+	// Earlier rows come first
+	if (rows.count > 0) {
+		vector_status res
+			= vec_bulk_insert(&line.buffer, 0, rows.data, rows.count);
+		assert(res == VECTOR_STATUS_OK);
+
+		if (config->echo_mode != NRL_ECHO_ON) {
+			memset(rows.data, 0, rows.count);
+		}
 	}
+	vec_deinit(&rows);
 
 	if (!deinit(config)) {
 		vec_deinit(&line.buffer);
@@ -155,6 +255,12 @@ char *nanorl(const nrl_config *config, nrl_error *error) {
 		return NULL;
 	}
 
+	// Cancel or timeout condition
+	if (read_stopped(error)) {
+		vec_deinit(&line.buffer);
+		return NULL;
+	}
+
 	// EOF condition
 	if (read_buf.eof && line.buffer.count == 0) {
 		vec_deinit(&line.buffer);
@@ -186,6 +292,34 @@ nrl_config nrl_default_config(void) {
 	return default_conf;
 }
 
+nrl_error nrl_session_begin(const nrl_config *config) {
+	if (session_active || !check_args(config)) {
+		return NRL_ERROR_ARG;
+	}
+
+	// Nothing to set up for non-interactive input
+	if (!isatty(config->read_file)) {
+		return NRL_ERROR_OK;
+	}
+
+	if (!session_init(config)) {
+		return NRL_ERROR_SYSTEM;
+	}
+
+	session_conf = *config;
+	session_active = true;
+	return NRL_ERROR_OK;
+}
+
+nrl_error nrl_session_end(void) {
+	if (!session_active) {
+		return NRL_ERROR_OK;
+	}
+
+	session_active = false;
+	return session_deinit(&session_conf) ? NRL_ERROR_OK : NRL_ERROR_SYSTEM;
+}
+
 /**
  * @brief Signal handler for all signals.
  *
@@ -212,37 +346,253 @@ static bool check_args(const nrl_config *config) {
 		return false;
 	}
 
+	if (config->layout_mode < NRL_LAYOUT_WRAP
+		|| config->layout_mode > NRL_LAYOUT_SCROLL) {
+		return false;
+	}
+
 	return true;
 }
 
 /**
- * @brief Perform library initialization.
+ * @brief Print queued messages above the line being edited.
+ */
+static void print_queued(void) {
+	if (!nrl_print_pending()) {
+		return;
+	}
+
+	// All queued messages share one redraw
+	nrl_render_hide(active_line);
+	nrl_print_write();
+	nrl_render_show(active_line);
+	nrl_io_flush();
+}
+
+/**
+ * @brief Check if input stopped because of a cancel or timeout.
+ *
+ * @param[out] error - Error code buffer (can be NULL); set if stopped.
+ * @return Whether input was stopped.
+ */
+static bool read_stopped(nrl_error *error) {
+	switch (errno) {
+	case ECANCELED:
+		safe_assign(error, NRL_ERROR_CANCEL);
+		return true;
+	case ETIMEDOUT:
+		safe_assign(error, NRL_ERROR_TIMEOUT);
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief Start a new row if the input is not complete.
+ *
+ * @param[in] config - Configuration.
+ * @param[in,out] line - Line data object; emptied for the new row.
+ * @param[in,out] rows - Finished rows, each ending with a newline.
+ * @param[in,out] state - Continuation hook state.
+ * @param[in] buf - Input that stopped the row.
+ * @return true - Input continues on a new row. \n
+ *         false - Input is complete.
+ */
+static bool next_row(const nrl_config *config,
+					 line_data *line,
+					 vector *rows,
+					 uint64_t *state,
+					 const input_buf *buf) {
+	if (config->continuation == NULL || buf->eof) {
+		return false;
+	}
+
+	uint32_t start = rows->count;
+	if (line->buffer.count > 0) {
+		vector_status res = vec_bulk_insert(rows, start, line->buffer.data,
+											line->buffer.count);
+		assert(res == VECTOR_STATUS_OK);
+	}
+
+	char newline = '\n';
+	vec_push(rows, &newline);
+
+	// Only the new row is checked
+	if (config->continuation((char *)rows->data + start, rows->count - start,
+							 state)) {
+		rows->count = start;
+		return false;
+	}
+
+	nrl_render_continue(line, config->continuation_prompt);
+	line->buffer.count = 0;
+	line->cursor = 0;
+	return true;
+}
+
+/**
+ * @brief Read a line from non-interactive input, without terminal handling or
+ * echo.
+ *
+ * @param[in] config - Configuration.
+ * @param[out] error - Error code buffer (can be NULL).
+ * @return Inputted line; NULL on some errors.
+ */
+static char *read_plain(const nrl_config *config, nrl_error *error) {
+	vector line = vec_init(sizeof(char));
+	if (config->preload != NULL) {
+		vector_status res = vec_bulk_insert(&line, 0, config->preload,
+											strlen(config->preload));
+		assert(res == VECTOR_STATUS_OK);
+	}
+
+	bool complete = nrl_io_read_line(config->read_file, &line);
+
+	// Unfinished input continues on the next line
+	uint64_t state = 0;
+	uint32_t checked = 0;
+	while (complete && config->continuation != NULL) {
+		char newline = '\n';
+		vec_push(&line, &newline);
+
+		if (config->continuation((char *)line.data + checked,
+								 line.count - checked, &state)) {
+			line.count--;
+			break;
+		}
+
+		checked = line.count;
+		complete = nrl_io_read_line(config->read_file, &line);
+	}
+
+	// Cancel or timeout condition
+	if (!complete && read_stopped(error)) {
+		vec_deinit(&line);
+		return NULL;
+	}
+
+	// EOF condition
+	if (!complete && line.count == 0) {
+		vec_deinit(&line);
+		safe_assign(error, (errno == EINTR) ? NRL_ERROR_INTERRUPT
+											: NRL_ERROR_EOF);
+		return NULL;
+	}
+
+	// Terminate string
+	char null_char = '\0';
+	vec_push(&line, &null_char);
+
+	// Interrupt condition
+	if (errno == EINTR) {
+		safe_assign(error, NRL_ERROR_INTERRUPT);
+	} else {
+		safe_assign(error, NRL_ERROR_OK);
+	}
+
+	return vec_collect(&line);
+}
+
+/**
+ * @brief Perform session initialization: terminal mode, signals and terminfo.
  *
  * @param[in] config - Configuration.
  * @return true - Successful init. \n
  *         false - Init failed.
  */
-static bool init(const nrl_config *config) {
-	if (!nrl_load_terminfo()) {
+static bool session_init(const nrl_config *config) {
+	// Reference left by a failed teardown
+	nrl_terminfo_release(session_terminal);
+
+	// Capabilities are reloaded if the terminal changed
+	session_terminal = nrl_terminfo_acquire();
+	if (session_terminal == NULL) {
 		return false;
 	}
-	nrl_dfa_build();
+	nrl_io_terminal(session_terminal);
 
 #if DFA_DEBUG == 1
-	nrl_dfa_print();
+	nrl_dfa_print(session_terminal->dfa);
 #endif // DFA_DEBUG
 
-	if (isatty(config->read_file)) {
-		if (tcgetattr(config->read_file, &old_attrs) < 0) {
+	// Redirected input has no terminal behind it
+	if (!nrl_io_redirected() && !terminal_init(config)) {
+		return false;
+	}
+
+	nrl_io_echo_state(true);
+	nrl_io_init(config->read_file, config->echo_file);
+	if (!config->assume_smkx) {
+		if (!nrl_io_write_escape(TIO_KEYPAD_XMIT)) {
 			return false;
 		}
+	}
+	if (paste_supported()) {
+		if (!nrl_io_write_escape(TIO_PASTE_ON)) {
+			return false;
+		}
+	}
+
+	return nrl_io_flush();
+}
+
+/**
+ * @brief Perform session teardown.
+ *
+ * @param[in] config - Configuration.
+ * @return true - Successful teardown. \n
+ *         false - Teardown failed.
+ */
+static bool session_deinit(const nrl_config *config) {
+	bool res = session_restore(config);
+
+	nrl_terminfo_release(session_terminal);
+	session_terminal = NULL;
+	return res;
+}
 
-		struct termios new_attrs = old_attrs;
-		new_attrs.c_lflag &= ~(ICANON | ECHO);
-		if (tcsetattr(config->read_file, TCSAFLUSH, &new_attrs) < 0) {
+/**
+ * @brief Restore terminal settings changed by the session.
+ *
+ * @param[in] config - Configuration.
+ * @return true - Successful restore. \n
+ *         false - Restore failed.
+ */
+static bool session_restore(const nrl_config *config) {
+	if (!nrl_io_redirected() && !terminal_deinit(config)) {
+		return false;
+	}
+
+	nrl_io_echo_state(true);
+	if (!nrl_io_write_escape(TIO_KEYPAD_LOCAL)) {
+		return false;
+	}
+	if (paste_supported()) {
+		if (!nrl_io_write_escape(TIO_PASTE_OFF)) {
 			return false;
 		}
 	}
+	return nrl_io_flush();
+}
+
+/**
+ * @brief Enter raw mode and install signal handlers.
+ *
+ * @param[in] config - Configuration.
+ * @return true - Successful setup. \n
+ *         false - Setup failed.
+ */
+static bool terminal_init(const nrl_config *config) {
+	if (tcgetattr(config->read_file, &old_attrs) < 0) {
+		return false;
+	}
+
+	struct termios new_attrs = old_attrs;
+	new_attrs.c_lflag &= ~(ICANON | ECHO);
+	if (tcsetattr(config->read_file, TCSANOW, &new_attrs) < 0) {
+		return false;
+	}
 
 	// Setup signals
 	struct sigaction nrl_sa;
@@ -257,14 +607,59 @@ static bool init(const nrl_config *config) {
 		return false;
 	}
 
+	return true;
+}
+
+/**
+ * @brief Restore terminal mode and signal handlers.
+ *
+ * @param[in] config - Configuration.
+ * @return true - Successful restore. \n
+ *         false - Restore failed.
+ */
+static bool terminal_deinit(const nrl_config *config) {
+	if (tcsetattr(config->read_file, TCSANOW, &old_attrs) < 0) {
+		return false;
+	}
+
+	// Reset signals
+	if (sigaction(SIGHUP, &old_sighup_sa, NULL) < 0
+		|| sigaction(SIGINT, &old_sigint_sa, NULL) < 0
+		|| sigaction(SIGTERM, &old_sigterm_sa, NULL) < 0
+		|| sigaction(SIGQUIT, &old_sigquit_sa, NULL) < 0) {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Check if pasted text can be recognized.
+ *
+ * @return Whether both bracketed paste markers are known.
+ */
+static bool paste_supported(void) {
+	return nrl_lookup_input(session_terminal, TII_PASTE_START).data != NULL
+		&& nrl_lookup_input(session_terminal, TII_PASTE_END).data != NULL;
+}
+
+/**
+ * @brief Perform library initialization.
+ *
+ * @param[in] config - Configuration.
+ * @return true - Successful init. \n
+ *         false - Init failed.
+ */
+static bool init(const nrl_config *config) {
+	if (!session_active && !session_init(config)) {
+		return false;
+	}
+
 	// IO initialization
 	nrl_io_echo_state(true);
-	nrl_io_init(config->read_file, config->echo_file, config->preload);
-	if (!config->assume_smkx) {
-		if (!nrl_io_write_escape(TIO_KEYPAD_XMIT)) {
-			return false;
-		}
-	}
+	nrl_io_init(config->read_file, config->echo_file);
+	nrl_highlight_init(config->highlighter);
+	nrl_render_init(config);
 
 	// Write prompt, if there is one
 	if (config->prompt != NULL) {
@@ -285,33 +680,17 @@ static bool init(const nrl_config *config) {
  *         false - Teardown failed.
  */
 static bool deinit(const nrl_config *config) {
-	if (isatty(config->read_file)) {
-		if (tcsetattr(config->read_file, TCSAFLUSH, &old_attrs) < 0) {
-			return false;
-		}
-	}
-
-	// Reset signals
-	if (sigaction(SIGHUP, &old_sighup_sa, NULL) < 0
-		|| sigaction(SIGINT, &old_sigint_sa, NULL) < 0
-		|| sigaction(SIGTERM, &old_sigterm_sa, NULL) < 0
-		|| sigaction(SIGQUIT, &old_sigquit_sa, NULL) < 0) {
-		return false;
-	}
-
 	// Delete secure data remains
 	if (config->echo_mode != NRL_ECHO_ON) {
 		nrl_io_wipe_buffers();
 	}
 
 	nrl_io_echo_state(true);
-	if (!nrl_io_write("\n", 1)) {
+	if (!nrl_io_write("\n", 1) || !nrl_io_flush()) {
 		return false;
 	}
-	if (!nrl_io_write_escape(TIO_KEYPAD_LOCAL)) {
-		return false;
-	}
-	return nrl_io_flush();
+
+	return session_active || session_deinit(config);
 }
 
 // @endcond
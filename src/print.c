@@ -0,0 +1,158 @@
+/**
+ * @cond internal
+ * @file print.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Messages printed above the line from other threads.
+ *
+ * Producers push onto a lock-free list and trigger a wakeup handle when the
+ * list was empty, so a burst of messages wakes the input loop once. The loop
+ * detaches the whole list with one exchange and writes it with a single
+ * redraw.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "print.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cancel.h"
+#include "io.h"
+#include "nanorl.h"
+
+/**
+ * @struct message
+ * Queued message.
+ *
+ * @var message::next
+ * Message queued before this one.
+ *
+ * @var message::length
+ * Text length.
+ *
+ * @var message::text
+ * Message text; not null-terminated.
+ */
+typedef struct message {
+	struct message *next;
+	uint32_t length;
+	char text[];
+} message;
+
+/**
+ * @var queue_head
+ * Most recently queued message; updated atomically.
+ */
+static message *queue_head = NULL;
+
+/**
+ * @var wakeup
+ * Triggered when messages are queued; reset by the input loop. Published
+ * atomically once created.
+ */
+static nrl_cancel *wakeup = NULL;
+
+static message *reverse(message *entry);
+
+bool nrl_print_async(const char *text) {
+	uint32_t length = strlen(text);
+	message *entry = malloc(sizeof(message) + length);
+	if (entry == NULL) {
+		return false;
+	}
+
+	entry->length = length;
+	memcpy(entry->text, text, length);
+
+	message *head = __atomic_load_n(&queue_head, __ATOMIC_RELAXED);
+	do {
+		entry->next = head;
+	} while (!__atomic_compare_exchange_n(&queue_head, &head, entry, true,
+										  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+	// Loop already has a wakeup for the earlier messages
+	nrl_cancel *handle = __atomic_load_n(&wakeup, __ATOMIC_SEQ_CST);
+	if (head == NULL && handle != NULL) {
+		nrl_cancel_trigger(handle);
+	}
+
+	return true;
+}
+
+int nrl_print_init(void) {
+	nrl_cancel *handle = __atomic_load_n(&wakeup, __ATOMIC_ACQUIRE);
+	if (handle == NULL) {
+		handle = nrl_cancel_create();
+		if (handle == NULL) {
+			return -1;
+		}
+
+		// Another thread may have published its handle first
+		nrl_cancel *expected = NULL;
+		if (!__atomic_compare_exchange_n(&wakeup, &expected, handle, false,
+										 __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+			nrl_cancel_free(handle);
+			handle = expected;
+		}
+
+		// Messages queued before the handle was published
+		if (__atomic_load_n(&queue_head, __ATOMIC_SEQ_CST) != NULL) {
+			nrl_cancel_trigger(handle);
+		}
+	}
+
+	return nrl_cancel_fd(handle);
+}
+
+bool nrl_print_pending(void) {
+	// Reset before checking, so later messages wake the loop again
+	nrl_cancel_reset(__atomic_load_n(&wakeup, __ATOMIC_ACQUIRE));
+
+	return __atomic_load_n(&queue_head, __ATOMIC_SEQ_CST) != NULL;
+}
+
+bool nrl_print_write(void) {
+	// Messages are pushed newest first
+	message *entry
+		= reverse(__atomic_exchange_n(&queue_head, NULL, __ATOMIC_ACQUIRE));
+
+	bool res = true;
+	while (entry != NULL) {
+		res = res && nrl_io_write(entry->text, entry->length);
+
+		// Each message takes whole rows
+		if (entry->length == 0 || entry->text[entry->length - 1] != '\n') {
+			res = res && nrl_io_write("\n", 1);
+		}
+
+		message *next = entry->next;
+		free(entry);
+		entry = next;
+	}
+
+	return res;
+}
+
+/**
+ * @brief Reverse a list of messages.
+ *
+ * @param[in] entry - First message; can be NULL.
+ * @return New first message.
+ */
+static message *reverse(message *entry) {
+	message *reversed = NULL;
+	while (entry != NULL) {
+		message *next = entry->next;
+		entry->next = reversed;
+		reversed = entry;
+		entry = next;
+	}
+
+	return reversed;
+}
+
+// @endcond
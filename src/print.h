@@ -0,0 +1,37 @@
+/**
+ * @cond internal
+ * @file print.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Messages printed above the line from other threads.
+ */
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @brief Create the wakeup handle, if not created yet.
+ *
+ * @return File descriptor that becomes readable when messages are queued;
+ * -1 if the handle could not be created.
+ */
+int nrl_print_init(void);
+
+/**
+ * @brief Check for queued messages, clearing the wakeup.
+ *
+ * @return Whether there are messages to write.
+ */
+bool nrl_print_pending(void);
+
+/**
+ * @brief Write all queued messages to the output.
+ *
+ * @return Whether write succeeded.
+ * @note Messages are removed from the queue even if writing fails.
+ */
+bool nrl_print_write(void);
+
+// @endcond
@@ -0,0 +1,35 @@
+/**
+ * @cond internal
+ * @file probes.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Static tracepoints.
+ *
+ * Probes are placed in the 'nanorl' provider:
+ * - read(fd, bytes): read system call completed.
+ * - dfa__accept(id), dfa__reject(char): escape sequence parse finished.
+ * - csi__accept(final), csi__reject(intro): generic control sequence parse
+ *   finished.
+ * - manip__entry(key, cursor), manip__return(key, cursor): key binding run.
+ * - insert__entry(cursor, length), insert__return(cursor, count): text
+ *   inserted.
+ * - render__start(cursor, count), render__end(bytes): line rendered.
+ * - flush__start(bytes), flush__end(written): output flushed.
+ */
+#pragma once
+
+#include "config.h"
+
+#if PROBES == 1
+#include <sys/sdt.h>
+
+#define PROBE1(name, arg1) DTRACE_PROBE1(nanorl, name, arg1)
+#define PROBE2(name, arg1, arg2) DTRACE_PROBE2(nanorl, name, arg1, arg2)
+#else
+#define PROBE1(name, arg1) ((void)(arg1))
+#define PROBE2(name, arg1, arg2) ((void)(arg1), (void)(arg2))
+#endif // PROBES
+
+// @endcond
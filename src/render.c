@@ -0,0 +1,472 @@
+/**
+ * @cond internal
+ * @file render.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Line rendering.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "render.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "config.h"
+#include "highlight.h"
+#include "history.h"
+#include "io.h"
+#include "manip.h"
+#include "nanorl.h"
+#include "probes.h"
+#include "screen.h"
+#include "stats.h"
+#include "terminfo.h"
+
+static nrl_echo_mode echo_mode = NRL_ECHO_ON;
+static nrl_layout_mode layout_mode = NRL_LAYOUT_WRAP;
+
+static const char *prompt = NULL;
+static uint32_t prompt_length = 0;
+
+/**
+ * Visible characters in scroll mode.
+ */
+static uint32_t scroll_width = 0;
+
+/**
+ * Scroll amount in scroll mode.
+ */
+static uint32_t scroll_step = 0;
+static uint32_t scroll_setting = 0;
+
+/**
+ * Terminal width.
+ */
+static uint32_t columns = 0;
+
+/**
+ * Whether spans are added when printing.
+ */
+static bool highlighted = false;
+
+/**
+ * Whether history suggestions are shown.
+ */
+static bool suggested = false;
+
+/**
+ * Renders performed.
+ */
+static uint64_t render_total = 0;
+
+static render_hook render_observer = NULL;
+
+static bool render(line_data *line);
+static uint32_t visible_count(const line_data *line);
+#if SCREEN_CHECK == 1
+static bool cells_match(uint32_t *pos, const char *data, uint32_t length);
+#endif // SCREEN_CHECK
+static bool update_scroll(line_data *line);
+static bool move_cursor(uint32_t from, uint32_t to);
+static void set_prompt(const char *text);
+
+void nrl_render_init(const nrl_config *config) {
+	echo_mode = config->echo_mode;
+	layout_mode = config->layout_mode;
+	highlighted = nrl_highlight_enabled() && echo_mode != NRL_ECHO_OBSCURED;
+	suggested = config->suggest && echo_mode == NRL_ECHO_ON;
+	scroll_setting = config->scroll_step;
+
+	// Redirected output has no terminal to query
+	struct winsize size;
+	columns = FALLBACK_COLUMNS;
+	if (!nrl_io_redirected() && ioctl(config->echo_file, TIOCGWINSZ, &size) == 0
+		&& size.ws_col > 0) {
+		columns = size.ws_col;
+	}
+
+	set_prompt(config->prompt);
+}
+
+bool nrl_render(line_data *line) {
+	PROBE2(render__start, line->cursor, line->buffer.count);
+	uint64_t written = nrl_io_written();
+
+	bool res = render(line);
+
+	uint64_t render_bytes = nrl_io_written() - written;
+	render_total++;
+	PROBE1(render__end, render_bytes);
+	STATS_ADD(renders, 1);
+	STATS_ADD(render_bytes, render_bytes);
+	STATS_MAX(render_bytes_max, render_bytes);
+
+	if (render_observer != NULL) {
+		render_observer(line, render_bytes);
+	}
+
+	return res;
+}
+
+bool nrl_render_finish(line_data *line) {
+	suggested = false;
+
+	// Erase suggestion
+	if (line->suggestion != NULL) {
+		line->suggestion = NULL;
+
+		if (!line->dirty || line->buffer.count < line->dirty_from) {
+			line->dirty_from = line->buffer.count;
+		}
+		line->dirty = true;
+	}
+
+	return nrl_render(line);
+}
+
+bool nrl_render_hide(line_data *line) {
+	// Cursor moves are only output with echo
+	bool res = move_cursor(line->render_cursor, 0);
+
+	nrl_io_echo_state(true);
+	res = res && nrl_io_write("\r", 1)
+		&& nrl_io_write_escape(TIO_CLEAR_EOS);
+
+	line->render_cursor = 0;
+	line->render_count = 0;
+	line->dirty = true;
+	line->dirty_from = 0;
+	return res;
+}
+
+bool nrl_render_show(line_data *line) {
+	bool res = (prompt == NULL) || nrl_io_write(prompt, prompt_length);
+
+	nrl_io_echo_state(echo_mode != NRL_ECHO_OFF);
+	return nrl_render(line) && res;
+}
+
+bool nrl_render_continue(line_data *line, const char *next_prompt) {
+	bool shown = suggested;
+	bool res = nrl_render_finish(line);
+	suggested = shown;
+
+	// Row is left as it is, like a submitted line
+	nrl_io_echo_state(true);
+	res = res && nrl_io_write("\n", 1);
+
+	line->render_cursor = 0;
+	line->render_count = 0;
+	line->scroll = 0;
+	line->dirty = true;
+	line->dirty_from = 0;
+
+	set_prompt(next_prompt);
+	res = res && (prompt == NULL || nrl_io_write(prompt, prompt_length));
+
+	nrl_io_echo_state(echo_mode != NRL_ECHO_OFF);
+	return res;
+}
+
+uint64_t nrl_render_count(void) {
+	return render_total;
+}
+
+void nrl_render_observe(render_hook hook) {
+	render_observer = hook;
+}
+
+#if SCREEN_CHECK == 1
+bool nrl_render_matches(const line_data *line) {
+	uint32_t pos = 0;
+	if (!cells_match(&pos, prompt, prompt_length)) {
+		return false;
+	}
+
+	uint32_t origin = pos;
+	uint32_t cursor = origin;
+
+	if (echo_mode != NRL_ECHO_OFF) {
+		uint32_t visible = visible_count(line);
+
+		if (echo_mode == NRL_ECHO_OBSCURED) {
+			for (uint32_t i = 0; i < visible; i++) {
+				if (!cells_match(&pos, "*", 1)) {
+					return false;
+				}
+			}
+		} else if (!cells_match(&pos, line->buffer.data + line->scroll,
+								visible)) {
+			return false;
+		}
+
+		// Rest of the printed count is the suggestion
+		if (line->render_count > visible
+			&& !cells_match(&pos, line->suggestion,
+							line->render_count - visible)) {
+			return false;
+		}
+
+		cursor = origin + line->cursor - line->scroll;
+	}
+
+	// Nothing is left over from previous renders
+	uint32_t size = nrl_screen_size();
+	for (; pos < size; pos++) {
+		if (nrl_screen_cell(pos) != ' ') {
+			return false;
+		}
+	}
+
+	return nrl_screen_cursor() == cursor;
+}
+#endif // SCREEN_CHECK
+
+/**
+ * @brief Bring the screen in sync with the line data.
+ *
+ * @param[in,out] line - Line data object.
+ * @return Whether write succeeded.
+ */
+static bool render(line_data *line) {
+	bool scrolled = update_scroll(line);
+
+	uint32_t first = line->scroll;
+	uint32_t target = line->cursor - first;
+
+	// Only the cursor has moved
+	if (!line->dirty && !scrolled) {
+		bool res = move_cursor(line->render_cursor, target);
+		line->render_cursor = target;
+		return res;
+	}
+
+	uint32_t visible = visible_count(line);
+
+	// Characters before the change are already on the screen
+	uint32_t start = first + visible;
+	if (line->dirty) {
+		start = line->dirty_from;
+		if (highlighted) {
+			uint32_t restyled = nrl_highlight_update(line, line->dirty_from);
+			if (restyled < start) {
+				start = restyled;
+			}
+		}
+	}
+
+	// Scrolled text is reprinted, but its styles are still valid
+	if (scrolled || start < first) {
+		start = first;
+	}
+	if (start > first + visible) {
+		start = first + visible;
+	}
+
+	// Move cursor to the first changed character
+	if (!move_cursor(line->render_cursor, start - first)) {
+		return false;
+	}
+
+	// Print line data
+	if (echo_mode == NRL_ECHO_OBSCURED) {
+		for (uint32_t i = start; i < first + visible; i++) {
+			if (!nrl_io_write("*", 1)) {
+				return false;
+			}
+		}
+	} else if (highlighted) {
+		if (!nrl_highlight_write(line, start, first + visible)) {
+			return false;
+		}
+	} else {
+		const char *data = line->buffer.data;
+		if (!nrl_io_write(data + start, first + visible - start)) {
+			return false;
+		}
+	}
+	uint32_t printed_count = visible;
+
+	// Print suggestion after the line
+	if (suggested) {
+		line->suggestion = nrl_history_suggest(
+			line->buffer.data, line->buffer.count, &line->suggestion_length);
+	}
+	if (line->suggestion != NULL && first + visible == line->buffer.count) {
+		uint32_t shown = line->suggestion_length;
+		if (layout_mode == NRL_LAYOUT_SCROLL
+			&& shown > scroll_width - visible) {
+			shown = scroll_width - visible;
+		}
+
+		if (shown > 0
+			&& (!nrl_io_write("\033[90m", 5)
+				|| !nrl_io_write(line->suggestion, shown)
+				|| !nrl_io_write("\033[m", 3))) {
+			return false;
+		}
+		printed_count += shown;
+	}
+	uint32_t shown_count = printed_count;
+
+	// Account for erased characters
+	for (; printed_count < line->render_count; printed_count++) {
+		if (!nrl_io_write(" ", 1)) {
+			return false;
+		}
+	}
+
+	// Cursor waits in the last column after filling a row, until the next
+	// character; move it to the following row to keep rows countable
+	if (layout_mode == NRL_LAYOUT_WRAP && printed_count > start - first
+		&& (prompt_length + printed_count) % columns == 0
+		&& !nrl_io_write("\r\n", 2)) {
+		return false;
+	}
+
+	// Move cursor to correct location
+	if (!move_cursor(printed_count, target)) {
+		return false;
+	}
+
+	line->dirty = false;
+	line->render_cursor = target;
+	line->render_count = shown_count;
+	return true;
+}
+
+/**
+ * @brief Count characters of the line shown on the screen.
+ *
+ * @param[in] line - Line data object.
+ * @return Visible character count, starting from the scroll position.
+ */
+static uint32_t visible_count(const line_data *line) {
+	uint32_t visible = line->buffer.count - line->scroll;
+	if (layout_mode == NRL_LAYOUT_SCROLL && visible > scroll_width) {
+		visible = scroll_width;
+	}
+
+	return visible;
+}
+
+#if SCREEN_CHECK == 1
+/**
+ * @brief Compare screen model cells to data.
+ *
+ * @param[in,out] pos - First cell; advanced past the compared cells.
+ * @param[in] data - Expected characters.
+ * @param[in] length - Data length.
+ * @return Whether all cells match.
+ */
+static bool cells_match(uint32_t *pos, const char *data, uint32_t length) {
+	for (uint32_t i = 0; i < length; i++) {
+		if (nrl_screen_cell((*pos)++) != data[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+#endif // SCREEN_CHECK
+
+/**
+ * @brief Shift the visible part of the line to contain the cursor.
+ *
+ * @param[in,out] line - Line data object.
+ * @return Whether the visible part changed and has to be reprinted.
+ */
+static bool update_scroll(line_data *line) {
+	if (layout_mode != NRL_LAYOUT_SCROLL) {
+		return false;
+	}
+
+	uint32_t old_scroll = line->scroll;
+
+	if (line->cursor < line->scroll) {
+		// Leave a step worth of characters to the left of the cursor
+		line->scroll = (line->cursor > scroll_step - 1)
+			? line->cursor - (scroll_step - 1)
+			: 0;
+	} else if (line->cursor >= line->scroll + scroll_width) {
+		// Leave a step worth of space to the right of the cursor
+		line->scroll = line->cursor - (scroll_width - scroll_step);
+	}
+
+	return line->scroll != old_scroll;
+}
+
+/**
+ * @brief Move the real cursor between two columns.
+ *
+ * @param[in] from - Current column.
+ * @param[in] to - Desired column.
+ * @return Whether write succeeded.
+ * @note In wrap mode, columns past the terminal width are on the following
+ * rows.
+ */
+static bool move_cursor(uint32_t from, uint32_t to) {
+	// Cursor does not move between rows with left and right
+	if (layout_mode == NRL_LAYOUT_WRAP) {
+		uint32_t from_row = (prompt_length + from) / columns;
+		uint32_t to_row = (prompt_length + to) / columns;
+
+		if (from_row != to_row) {
+			if (!nrl_io_write("\r", 1)) {
+				return false;
+			}
+			if (from_row > to_row
+				&& !nrl_io_write_move(TIO_CURSOR_UP, TIO_PARM_UP,
+									  from_row - to_row)) {
+				return false;
+			}
+			if (from_row < to_row
+				&& !nrl_io_write_move(TIO_CURSOR_DOWN, TIO_PARM_DOWN,
+									  to_row - from_row)) {
+				return false;
+			}
+
+			// Move right from the start of the row
+			return nrl_io_write_move(TIO_CURSOR_RIGHT, TIO_PARM_RIGHT,
+									 (prompt_length + to) % columns);
+		}
+	}
+
+	if (from > to) {
+		return nrl_io_write_move(TIO_CURSOR_LEFT, TIO_PARM_LEFT, from - to);
+	}
+
+	return nrl_io_write_move(TIO_CURSOR_RIGHT, TIO_PARM_RIGHT, to - from);
+}
+
+/**
+ * @brief Use a new prompt for the following renders.
+ *
+ * @param[in] text - Prompt; can be NULL.
+ */
+static void set_prompt(const char *text) {
+	prompt = text;
+	prompt_length = (prompt == NULL) ? 0 : strlen(prompt);
+
+	if (layout_mode != NRL_LAYOUT_SCROLL) {
+		return;
+	}
+
+	// Keep last column empty to avoid wrapping
+	scroll_width
+		= (columns > prompt_length + 1) ? columns - prompt_length - 1 : 1;
+
+	scroll_step = scroll_setting;
+	if (scroll_step == 0) {
+		scroll_step = (scroll_width + 1) / 2;
+	}
+	if (scroll_step > scroll_width) {
+		scroll_step = scroll_width;
+	}
+}
+
+// @endcond
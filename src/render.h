@@ -0,0 +1,110 @@
+/**
+ * @cond internal
+ * @file render.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Line rendering.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "manip.h"
+#include "nanorl.h"
+
+/**
+ * @def FALLBACK_COLUMNS
+ * Terminal width to assume when it can't be queried.
+ */
+#define FALLBACK_COLUMNS 80
+
+/**
+ * @typedef render_hook
+ * Observer of every render, called with the bytes it output.
+ */
+typedef void (*render_hook)(const line_data *line, uint64_t bytes);
+
+/**
+ * @brief Prepare renderer for a new line.
+ *
+ * @param[in] config - Configuration.
+ */
+void nrl_render_init(const nrl_config *config);
+
+/**
+ * @brief Bring the screen in sync with the line data.
+ *
+ * @param[in,out] line - Line data object.
+ * @return Whether write succeeded.
+ */
+bool nrl_render(line_data *line);
+
+/**
+ * @brief Render the line for the last time, without the suggestion.
+ *
+ * @param[in,out] line - Line data object.
+ * @return Whether write succeeded.
+ */
+bool nrl_render_finish(line_data *line);
+
+/**
+ * @brief Finish the row like a submitted line and start the next one.
+ *
+ * @param[in,out] line - Line data object; to be emptied by the caller before
+ * the next render.
+ * @param[in] next_prompt - Prompt for the next row; can be NULL.
+ * @return Whether write succeeded.
+ */
+bool nrl_render_continue(line_data *line, const char *next_prompt);
+
+/**
+ * @brief Get total amount of renders.
+ *
+ * @return Render count since the library was loaded.
+ */
+uint64_t nrl_render_count(void);
+
+/**
+ * @brief Erase the prompt and the line, leaving the cursor at the start of
+ * the row.
+ *
+ * @param[in,out] line - Line data object; marked for a full redraw.
+ * @return Whether write succeeded.
+ * @note Output is enabled until @ref nrl_render_show, even without echo.
+ */
+bool nrl_render_hide(line_data *line);
+
+/**
+ * @brief Print the prompt and the line again after @ref nrl_render_hide.
+ *
+ * @param[in,out] line - Line data object.
+ * @return Whether write succeeded.
+ */
+bool nrl_render_show(line_data *line);
+
+/**
+ * @brief Set the render observer.
+ *
+ * @param[in] hook - Function called after each render; NULL to remove.
+ */
+void nrl_render_observe(render_hook hook);
+
+#if SCREEN_CHECK == 1
+/**
+ * @brief Check that the screen model shows the rendered line.
+ *
+ * The prompt is expected at the top left corner, followed by the visible
+ * part of the line and the suggestion; all other cells have to be blank.
+ *
+ * @param[in] line - Line data object.
+ * @return Whether the screen matches.
+ * @note Output has to be flushed into the screen model beforehand.
+ */
+bool nrl_render_matches(const line_data *line);
+#endif // SCREEN_CHECK
+
+// @endcond
@@ -0,0 +1,376 @@
+/**
+ * @cond internal
+ * @file replay.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Input recording and replay.
+ *
+ * Recording format: the magic "NRLR" and a version byte, followed by one
+ * record per chunk of input. A record is the time since the previous record
+ * (or the start) in nanoseconds and the chunk length, both as LEB128
+ * variable length integers, followed by the chunk data.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "nanorl.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "io.h"
+#include "manip.h"
+#include "render.h"
+#include "screen.h"
+#include "terminfo.h"
+
+#define RECORD_MAGIC "NRLR"
+#define RECORD_MAGIC_SIZE 4
+#define RECORD_VERSION 1
+
+/**
+ * @def VARINT_MAX_SIZE
+ * Maximum encoded size of a 64-bit integer.
+ */
+#define VARINT_MAX_SIZE 10
+
+/**
+ * @def REPLAY_BUF_SIZE
+ * Initial size of the buffer for the recording.
+ */
+#define REPLAY_BUF_SIZE 65536
+
+static int record_file = -1;
+static uint64_t record_last = 0;
+
+/**
+ * Recording being replayed.
+ */
+static char *replay_data = NULL;
+static size_t replay_size = 0;
+static size_t replay_pos = 0;
+static bool replay_valid = false;
+
+/**
+ * Unread part of the current chunk.
+ */
+static const char *chunk_data = NULL;
+static uint64_t chunk_left = 0;
+
+static nrl_replay_report *replay_report = NULL;
+
+static void record_chunk(const char *data, uint32_t length);
+static ssize_t replay_source(void *buf, size_t count);
+static bool replay_sink(const char *data, uint32_t length);
+static void replay_render(const line_data *line, uint64_t bytes);
+static bool screen_reset(void);
+static bool load_recording(int fd);
+static uint64_t time_ns(clockid_t clock);
+static uint32_t varint_write(char *buf, uint64_t value);
+static bool varint_read(uint64_t *value);
+
+bool nrl_record_start(int fd) {
+	if (fd < 0 || replay_data != NULL) {
+		return false;
+	}
+
+	char header[RECORD_MAGIC_SIZE + 1];
+	memcpy(header, RECORD_MAGIC, RECORD_MAGIC_SIZE);
+	header[RECORD_MAGIC_SIZE] = RECORD_VERSION;
+	if (write(fd, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+
+	record_file = fd;
+	record_last = time_ns(CLOCK_MONOTONIC);
+	nrl_io_tap(&record_chunk);
+
+	return true;
+}
+
+void nrl_record_stop(void) {
+	nrl_io_tap(NULL);
+	record_file = -1;
+}
+
+nrl_error nrl_replay(int fd,
+					 const nrl_config *config,
+					 nrl_replay_report *report) {
+	// Replayed input would be recorded again
+	if (record_file != -1 || replay_data != NULL) {
+		return NRL_ERROR_ARG;
+	}
+
+	errno = 0;
+	if (!load_recording(fd)) {
+		free(replay_data);
+		replay_data = NULL;
+		return (errno != 0) ? NRL_ERROR_SYSTEM : NRL_ERROR_ARG;
+	}
+
+	memset(report, 0, sizeof(nrl_replay_report));
+	replay_report = report;
+	replay_valid = true;
+	chunk_left = 0;
+
+	uint64_t renders = nrl_render_count();
+	uint64_t cpu_start = time_ns(CLOCK_PROCESS_CPUTIME_ID);
+	nrl_terminfo_pin(true);
+	nrl_io_redirect(&replay_source, &replay_sink);
+	nrl_render_observe(&replay_render);
+
+	// Edit lines until the recording runs out, each on a clear screen
+	nrl_error res = NRL_ERROR_SYSTEM;
+	char *line = NULL;
+	while (screen_reset() && (line = nanorl(config, &res)) != NULL) {
+		free(line);
+		report->lines++;
+	}
+
+	nrl_render_observe(NULL);
+	nrl_io_redirect(NULL, NULL);
+	nrl_terminfo_pin(false);
+#if SCREEN_CHECK == 1
+	nrl_screen_free();
+#endif // SCREEN_CHECK
+	report->cpu_time_ns = time_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+	report->renders = nrl_render_count() - renders;
+
+	free(replay_data);
+	replay_data = NULL;
+	replay_report = NULL;
+
+	// Invalid records stop input early
+	if (!replay_valid) {
+		return NRL_ERROR_ARG;
+	}
+
+	return (res == NRL_ERROR_EOF) ? NRL_ERROR_OK : res;
+}
+
+/**
+ * @brief Write a chunk of input to the recording.
+ *
+ * @param[in] data - Chunk data.
+ * @param[in] length - Chunk length.
+ * @note Recording stops on write errors.
+ */
+static void record_chunk(const char *data, uint32_t length) {
+	uint64_t now = time_ns(CLOCK_MONOTONIC);
+
+	char header[VARINT_MAX_SIZE * 2];
+	uint32_t header_size = varint_write(header, now - record_last);
+	header_size += varint_write(header + header_size, length);
+	record_last = now;
+
+	struct iovec parts[2] = {
+		{ .iov_base = header, .iov_len = header_size },
+		{ .iov_base = (void *)data, .iov_len = length },
+	};
+	if (writev(record_file, parts, 2) != (ssize_t)(header_size + length)) {
+		nrl_record_stop();
+	}
+}
+
+/**
+ * @brief Return recorded chunks in place of reads.
+ *
+ * @param[out] buf - Buffer for data.
+ * @param[in] count - Max size to return.
+ * @return Amount of bytes returned; 0 at the end of the recording.
+ * @note Chunks larger than count are returned over multiple calls.
+ */
+static ssize_t replay_source(void *buf, size_t count) {
+	if (chunk_left == 0) {
+		if (replay_pos == replay_size) {
+			return 0;
+		}
+
+		uint64_t delta;
+		uint64_t length;
+		if (!varint_read(&delta) || !varint_read(&length)
+			|| length > replay_size - replay_pos) {
+			replay_valid = false;
+			replay_pos = replay_size;
+			return 0;
+		}
+
+		chunk_data = replay_data + replay_pos;
+		chunk_left = length;
+		replay_pos += length;
+
+		replay_report->chunks++;
+		replay_report->input_bytes += length;
+		replay_report->recorded_time_ns += delta;
+	}
+
+	size_t bytes = (chunk_left < count) ? chunk_left : count;
+	memcpy(buf, chunk_data, bytes);
+	chunk_data += bytes;
+	chunk_left -= bytes;
+
+	return bytes;
+}
+
+/**
+ * @brief Count output and pass it to the screen model, if built.
+ *
+ * @param[in] data - Data buffer.
+ * @param[in] length - Data length.
+ * @return Always true.
+ */
+static bool replay_sink(const char *data, uint32_t length) {
+	replay_report->output_bytes += length;
+#if SCREEN_CHECK == 1
+	nrl_screen_feed(data, length);
+#else
+	(void)data;
+#endif // SCREEN_CHECK
+	return true;
+}
+
+/**
+ * @brief Check the screen after a render.
+ *
+ * @param[in] line - Rendered line.
+ * @param[in] bytes - Bytes output by the render.
+ */
+static void replay_render(const line_data *line, uint64_t bytes) {
+	if (bytes > replay_report->render_bytes_max) {
+		replay_report->render_bytes_max = bytes;
+	}
+
+#if SCREEN_CHECK == 1
+	// Render output is still buffered
+	if (!nrl_io_flush() || !nrl_render_matches(line)) {
+		replay_report->screen_mismatches++;
+	}
+#else
+	(void)line;
+#endif // SCREEN_CHECK
+}
+
+/**
+ * @brief Clear the screen model before a line.
+ *
+ * @return Whether the screen is ready; always true without the model.
+ */
+static bool screen_reset(void) {
+#if SCREEN_CHECK == 1
+	return nrl_screen_reset(FALLBACK_COLUMNS);
+#else
+	return true;
+#endif // SCREEN_CHECK
+}
+
+/**
+ * @brief Read the whole recording and check the header.
+ *
+ * @param[in] fd - File descriptor to read from.
+ * @return true - Recording loaded. \n
+ *         false - Read error (errno is set) or invalid header.
+ */
+static bool load_recording(int fd) {
+	size_t capacity = REPLAY_BUF_SIZE;
+	replay_data = malloc(capacity);
+	replay_size = 0;
+	if (replay_data == NULL) {
+		return false;
+	}
+
+	while (true) {
+		if (replay_size == capacity) {
+			char *grown = realloc(replay_data, capacity * 2);
+			if (grown == NULL) {
+				return false;
+			}
+
+			replay_data = grown;
+			capacity *= 2;
+		}
+
+		ssize_t bytes
+			= read(fd, replay_data + replay_size, capacity - replay_size);
+		if (bytes < 0) {
+			return false;
+		}
+		if (bytes == 0) {
+			break;
+		}
+
+		replay_size += bytes;
+	}
+
+	if (replay_size < RECORD_MAGIC_SIZE + 1
+		|| memcmp(replay_data, RECORD_MAGIC, RECORD_MAGIC_SIZE) != 0
+		|| replay_data[RECORD_MAGIC_SIZE] != RECORD_VERSION) {
+		return false;
+	}
+
+	replay_pos = RECORD_MAGIC_SIZE + 1;
+	return true;
+}
+
+/**
+ * @brief Read a clock.
+ *
+ * @param[in] clock - Clock to read.
+ * @return Clock value in nanoseconds.
+ */
+static uint64_t time_ns(clockid_t clock) {
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Encode an integer as LEB128.
+ *
+ * @param[out] buf - Buffer of at least VARINT_MAX_SIZE bytes.
+ * @param[in] value - Value to encode.
+ * @return Encoded size.
+ */
+static uint32_t varint_write(char *buf, uint64_t value) {
+	uint32_t size = 0;
+	while (value >= 0x80) {
+		buf[size++] = (char)(value | 0x80);
+		value >>= 7;
+	}
+	buf[size++] = (char)value;
+
+	return size;
+}
+
+/**
+ * @brief Decode an LEB128 integer from the recording.
+ *
+ * @param[out] value - Decoded value.
+ * @return true - Value decoded. \n
+ *         false - Recording ended or value is invalid.
+ */
+static bool varint_read(uint64_t *value) {
+	*value = 0;
+	for (uint32_t shift = 0; shift < VARINT_MAX_SIZE * 7; shift += 7) {
+		if (replay_pos == replay_size) {
+			return false;
+		}
+
+		unsigned char byte = replay_data[replay_pos++];
+		*value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// @endcond
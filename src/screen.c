@@ -0,0 +1,376 @@
+/**
+ * @cond internal
+ * @file screen.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Headless terminal screen model.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "screen.h"
+
+#include "config.h"
+
+#if SCREEN_CHECK == 1
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @def SCREEN_MAX_PARAMS
+ * Numeric parameters kept for a control sequence; the rest are ignored.
+ */
+#define SCREEN_MAX_PARAMS 4
+
+/**
+ * @def SCREEN_TAB_WIDTH
+ * Distance between tab stops.
+ */
+#define SCREEN_TAB_WIDTH 8
+
+/**
+ * @enum parse_state
+ * Output parser state.
+ */
+typedef enum {
+	STATE_GROUND,
+	STATE_ESCAPE,
+	STATE_CSI,
+	STATE_SS3,
+} parse_state;
+
+static char *cells = NULL;
+static uint32_t columns = 0;
+static uint32_t rows = 0;
+static uint32_t capacity = 0;
+
+static uint32_t cursor_row = 0;
+static uint32_t cursor_col = 0;
+
+/**
+ * Whether the last column was printed to; the next character goes to the
+ * start of the following row.
+ */
+static bool wrap_pending = false;
+
+static parse_state state = STATE_GROUND;
+static uint32_t params[SCREEN_MAX_PARAMS];
+static uint32_t param_count = 0;
+static bool private_mode = false;
+
+static void feed_char(char c);
+static void print_char(char c);
+static void control_char(char c);
+static void csi_param(char c);
+static void csi_dispatch(char final);
+static uint32_t param_or(uint32_t index, uint32_t fallback);
+static void clear_cells(uint32_t from, uint32_t to);
+static bool ensure_row(uint32_t row);
+
+bool nrl_screen_reset(uint32_t width) {
+	// Rows are allocated for the old width
+	if (width != columns) {
+		nrl_screen_free();
+		columns = (width > 0) ? width : 1;
+	}
+
+	rows = 0;
+	cursor_row = 0;
+	cursor_col = 0;
+	wrap_pending = false;
+	state = STATE_GROUND;
+
+	return ensure_row(0);
+}
+
+void nrl_screen_feed(const char *data, uint32_t length) {
+	for (uint32_t i = 0; i < length; i++) {
+		feed_char(data[i]);
+	}
+}
+
+char nrl_screen_cell(uint32_t pos) {
+	if (pos >= rows * columns) {
+		return ' ';
+	}
+
+	return cells[pos];
+}
+
+uint32_t nrl_screen_size(void) {
+	return rows * columns;
+}
+
+uint32_t nrl_screen_cursor(void) {
+	uint32_t pos = cursor_row * columns + cursor_col;
+	return wrap_pending ? pos + 1 : pos;
+}
+
+void nrl_screen_free(void) {
+	free(cells);
+	cells = NULL;
+	rows = 0;
+	capacity = 0;
+}
+
+/**
+ * @brief Advance the parser by one character.
+ *
+ * @param[in] c - Output character.
+ */
+static void feed_char(char c) {
+	// Escape aborts any sequence in progress
+	if (c == '\033') {
+		state = STATE_ESCAPE;
+		return;
+	}
+
+	switch (state) {
+	case STATE_GROUND:
+		if ((unsigned char)c < 0x20 || c == 0x7f) {
+			control_char(c);
+		} else {
+			print_char(c);
+		}
+		break;
+	case STATE_ESCAPE:
+		if (c == '[') {
+			param_count = 0;
+			private_mode = false;
+			state = STATE_CSI;
+		} else if (c == 'O') {
+			state = STATE_SS3;
+		} else {
+			// Keypad modes and others do not affect cells
+			state = STATE_GROUND;
+		}
+		break;
+	case STATE_CSI:
+		if (c >= 0x40 && c <= 0x7e) {
+			csi_dispatch(c);
+			state = STATE_GROUND;
+		} else {
+			csi_param(c);
+		}
+		break;
+	case STATE_SS3:
+		state = STATE_GROUND;
+		break;
+	}
+}
+
+/**
+ * @brief Print a character at the cursor.
+ *
+ * @param[in] c - Printable character.
+ */
+static void print_char(char c) {
+	if (wrap_pending) {
+		wrap_pending = false;
+		cursor_col = 0;
+		cursor_row++;
+	}
+
+	if (!ensure_row(cursor_row)) {
+		return;
+	}
+
+	cells[cursor_row * columns + cursor_col] = c;
+	if (cursor_col + 1 == columns) {
+		wrap_pending = true;
+	} else {
+		cursor_col++;
+	}
+}
+
+/**
+ * @brief Perform a C0 control function.
+ *
+ * @param[in] c - Control character.
+ * @note Newline also returns the carriage, as with output post-processing.
+ */
+static void control_char(char c) {
+	switch (c) {
+	case '\b':
+		wrap_pending = false;
+		if (cursor_col > 0) {
+			cursor_col--;
+		}
+		break;
+	case '\t':
+		cursor_col += SCREEN_TAB_WIDTH - cursor_col % SCREEN_TAB_WIDTH;
+		if (cursor_col >= columns) {
+			cursor_col = columns - 1;
+		}
+		break;
+	case '\n':
+		cursor_row++;
+		ensure_row(cursor_row);
+		// fallthrough
+	case '\r':
+		cursor_col = 0;
+		wrap_pending = false;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Collect a control sequence parameter character.
+ *
+ * @param[in] c - Parameter or intermediate character.
+ */
+static void csi_param(char c) {
+	if (c == '?') {
+		private_mode = true;
+		return;
+	}
+
+	if (param_count == 0) {
+		params[0] = 0;
+		param_count = 1;
+	}
+
+	if (c == ';') {
+		if (param_count < SCREEN_MAX_PARAMS) {
+			params[param_count] = 0;
+		}
+		param_count++;
+	} else if (c >= '0' && c <= '9' && param_count <= SCREEN_MAX_PARAMS) {
+		params[param_count - 1] = params[param_count - 1] * 10 + (c - '0');
+	}
+}
+
+/**
+ * @brief Perform a control sequence function.
+ *
+ * @param[in] final - Final character of the sequence.
+ * @note Private modes and attributes do not affect cells and are ignored.
+ */
+static void csi_dispatch(char final) {
+	if (private_mode) {
+		return;
+	}
+
+	uint32_t amount = param_or(0, 1);
+	uint32_t row_start = cursor_row * columns;
+
+	switch (final) {
+	case 'A':
+		cursor_row = (cursor_row > amount) ? cursor_row - amount : 0;
+		break;
+	case 'B':
+		cursor_row += amount;
+		ensure_row(cursor_row);
+		break;
+	case 'C':
+		cursor_col = (cursor_col + amount < columns) ? cursor_col + amount
+													 : columns - 1;
+		break;
+	case 'D':
+		cursor_col = (cursor_col > amount) ? cursor_col - amount : 0;
+		break;
+	case 'G':
+		cursor_col = (amount <= columns) ? amount - 1 : columns - 1;
+		break;
+	case 'H':
+		cursor_row = param_or(0, 1) - 1;
+		cursor_col = param_or(1, 1) - 1;
+		if (cursor_col >= columns) {
+			cursor_col = columns - 1;
+		}
+		ensure_row(cursor_row);
+		break;
+	case 'J':
+		if (param_or(0, 0) == 0) {
+			clear_cells(row_start + cursor_col, rows * columns);
+		}
+		break;
+	case 'K':
+		switch (param_or(0, 0)) {
+		case 0:
+			clear_cells(row_start + cursor_col, row_start + columns);
+			break;
+		case 1:
+			clear_cells(row_start, row_start + cursor_col + 1);
+			break;
+		case 2:
+			clear_cells(row_start, row_start + columns);
+			break;
+		}
+		break;
+	default:
+		return;
+	}
+
+	wrap_pending = false;
+}
+
+/**
+ * @brief Get a control sequence parameter.
+ *
+ * @param[in] index - Parameter index.
+ * @param[in] fallback - Value for missing or zero parameters.
+ * @return Parameter value.
+ */
+static uint32_t param_or(uint32_t index, uint32_t fallback) {
+	if (index >= param_count || index >= SCREEN_MAX_PARAMS
+		|| params[index] == 0) {
+		return fallback;
+	}
+
+	return params[index];
+}
+
+/**
+ * @brief Blank a range of cells.
+ *
+ * @param[in] from - First cell.
+ * @param[in] to - Cell to stop at (exclusive).
+ */
+static void clear_cells(uint32_t from, uint32_t to) {
+	if (to > rows * columns) {
+		to = rows * columns;
+	}
+	if (from < to) {
+		memset(cells + from, ' ', to - from);
+	}
+}
+
+/**
+ * @brief Add blank rows up to the given one.
+ *
+ * @param[in] row - Row that has to exist.
+ * @return Whether the row exists.
+ */
+static bool ensure_row(uint32_t row) {
+	if (row < rows) {
+		return true;
+	}
+
+	if (row >= capacity) {
+		uint32_t grown_capacity = (capacity > 0) ? capacity : 1;
+		while (grown_capacity <= row) {
+			grown_capacity *= 2;
+		}
+
+		char *grown = realloc(cells, (size_t)grown_capacity * columns);
+		if (grown == NULL) {
+			return false;
+		}
+
+		cells = grown;
+		capacity = grown_capacity;
+	}
+
+	memset(cells + rows * columns, ' ', (row + 1 - rows) * columns);
+	rows = row + 1;
+	return true;
+}
+#endif // SCREEN_CHECK
+
+// @endcond
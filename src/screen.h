@@ -0,0 +1,67 @@
+/**
+ * @cond internal
+ * @file screen.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Headless terminal screen model.
+ *
+ * Interprets the VT100/xterm subset used by the bundled terminal tables.
+ * Rows are never scrolled away, so positions are counted in cells from the
+ * top left corner, row by row. Only built with SCREEN_CHECK, for tests.
+ */
+#pragma once
+
+#include "config.h"
+
+#if SCREEN_CHECK == 1
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Clear the screen and move the cursor to the top left corner.
+ *
+ * @param[in] width - Screen width.
+ * @return Whether the screen was allocated.
+ */
+bool nrl_screen_reset(uint32_t width);
+
+/**
+ * @brief Interpret terminal output.
+ *
+ * @param[in] data - Output data.
+ * @param[in] length - Data length.
+ * @note Sequences may be split between calls.
+ */
+void nrl_screen_feed(const char *data, uint32_t length);
+
+/**
+ * @brief Get character in a cell.
+ *
+ * @param[in] pos - Cell position.
+ * @return Character; space for empty cells and cells past the screen end.
+ */
+char nrl_screen_cell(uint32_t pos);
+
+/**
+ * @brief Get amount of cells in use.
+ *
+ * @return Position past the last row.
+ */
+uint32_t nrl_screen_size(void);
+
+/**
+ * @brief Get cursor position.
+ *
+ * @return Cell the next character will be printed to.
+ */
+uint32_t nrl_screen_cursor(void);
+
+/**
+ * @brief Free screen memory.
+ */
+void nrl_screen_free(void);
+#endif // SCREEN_CHECK
+
+// @endcond
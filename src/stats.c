@@ -0,0 +1,71 @@
+/**
+ * @cond internal
+ * @file stats.c
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Runtime statistics.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "stats.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "nanorl.h"
+
+#if STATS == 1
+// extern
+nrl_stats nrl_stats_data;
+
+static struct timespec input_time;
+static bool input_pending = false;
+
+void nrl_stats_input(void) {
+	if (!input_pending) {
+		clock_gettime(CLOCK_MONOTONIC, &input_time);
+		input_pending = true;
+	}
+}
+
+void nrl_stats_flush(void) {
+	if (!input_pending) {
+		return;
+	}
+	input_pending = false;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t micros = (now.tv_sec - input_time.tv_sec) * 1000000
+		+ (now.tv_nsec - input_time.tv_nsec) / 1000;
+
+	// Bucket by power of two
+	uint32_t bucket = 0;
+	while (micros > 0 && bucket < NRL_STATS_LATENCY_BUCKETS - 1) {
+		micros >>= 1;
+		bucket++;
+	}
+	nrl_stats_data.latency[bucket]++;
+}
+#endif // STATS
+
+void nrl_stats_get(nrl_stats *stats) {
+#if STATS == 1
+	*stats = nrl_stats_data;
+#else
+	memset(stats, 0, sizeof(nrl_stats));
+#endif // STATS
+}
+
+void nrl_stats_reset(void) {
+#if STATS == 1
+	memset(&nrl_stats_data, 0, sizeof(nrl_stats));
+	input_pending = false;
+#endif // STATS
+}
+
+// @endcond
@@ -0,0 +1,50 @@
+/**
+ * @cond internal
+ * @file stats.h
+ * @author Vladyslav Aviedov <vladaviedov at protonmail dot com>
+ * @version v2-pre0.1
+ * @date 2024
+ * @license LGPLv3.0
+ * @brief Runtime statistics.
+ */
+#pragma once
+
+#include "config.h"
+#include "nanorl.h"
+
+#if STATS == 1
+/**
+ * @var nrl_stats_data
+ * Collected statistics.
+ */
+extern nrl_stats nrl_stats_data;
+
+/**
+ * @brief Record time of the input read.
+ *
+ * @note Only the first input since the last flush is recorded.
+ */
+void nrl_stats_input(void);
+
+/**
+ * @brief Record latency from the recorded input to now.
+ */
+void nrl_stats_flush(void);
+
+#define STATS_ADD(field, value) (nrl_stats_data.field += (value))
+#define STATS_MAX(field, value)                                                \
+	do {                                                                       \
+		if ((value) > nrl_stats_data.field) {                                  \
+			nrl_stats_data.field = (value);                                    \
+		}                                                                      \
+	} while (0)
+#define STATS_INPUT() nrl_stats_input()
+#define STATS_FLUSH() nrl_stats_flush()
+#else
+#define STATS_ADD(field, value) ((void)(value))
+#define STATS_MAX(field, value) ((void)(value))
+#define STATS_INPUT() ((void)0)
+#define STATS_FLUSH() ((void)0)
+#endif // STATS
+
+// @endcond
@@ -10,13 +10,21 @@
 #define _POSIX_C_SOURCE 200809L
 #include "terminfo.h"
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "config.h"
+#include "dfa.h"
 #include "fastload.h"
 
 /**
@@ -33,6 +41,20 @@
  */
 #define MAGIC_INT32 01036
 
+/**
+ * @def HEADER_SIZE
+ * Size of the entry header in bytes.
+ * @note Reference: 'man term'
+ */
+#define HEADER_SIZE 12
+
+/**
+ * @def EXT_HEADER_SIZE
+ * Size of the extended section header in bytes.
+ * @note Reference: 'man term'
+ */
+#define EXT_HEADER_SIZE 10
+
 /**
  * @var sysdb_path
  * Locations of the system terminfo databases. At least one macro should be
@@ -75,78 +97,315 @@ static const uint8_t input_seq_indices[] = {
 	59u,  // key_dc
 };
 
+/**
+ * @var input_ext_names
+ * Names of extended capabilities for input escape sequences, starting from
+ * @ref TII_STANDARD_COUNT.
+ * @note Reference: ncurses source 'include/Caps-ncurses'
+ */
+static const char *input_ext_names[] = {
+	"kLFT5", // control + key_left
+	"kRIT5", // control + key_right
+	"kLFT3", // alt + key_left
+	"kRIT3", // alt + key_right
+	"kDC5",  // control + key_dc
+	"PS",    // bracketed paste start
+	"PE",    // bracketed paste end
+};
+
 /**
  * @var output_seq_indices
  * Indices into the strings terminfo array for output escape sequences.
  * @note Reference: ncurses source 'include/Caps'
  */
 static const uint8_t output_seq_indices[] = {
-	14u, // cursor_left
-	17u, // cursor_right,
-	88u, // keypad_local
-	89u  // keypad_xmit
+	14u,  // cursor_left
+	17u,  // cursor_right,
+	19u,  // cursor_up
+	11u,  // cursor_down
+	88u,  // keypad_local
+	89u,  // keypad_xmit
+	7u,   // clr_eos
+	111u, // parm_left_cursor
+	112u, // parm_right_cursor
+	114u, // parm_up_cursor
+	107u, // parm_down_cursor
 };
 
-static bool attempted_load = false;
-static bool load_result = false;
-
-static char *inputs[TII_COUNT] = { NULL };
-static char *outputs[TIO_COUNT] = { NULL };
+/**
+ * @var output_ext_names
+ * Names of extended capabilities for output escape sequences, starting from
+ * @ref TIO_STANDARD_COUNT.
+ * @note Reference: ncurses source 'include/Caps-ncurses'
+ */
+static const char *output_ext_names[] = {
+	"BE", // enable bracketed paste
+	"BD", // disable bracketed paste
+};
 
-static FILE *find_entry(const char *term);
-static FILE *try_open(const char *db_path, const char *term);
-static bool parse(FILE *terminfo);
+/**
+ * @var reload_lock
+ * Serializes loading and replacing the latest snapshot. Snapshots that are
+ * still current are acquired and released without it.
+ */
+static pthread_mutex_t reload_lock = PTHREAD_MUTEX_INITIALIZER;
 
-bool nrl_load_terminfo(void) {
-	if (attempted_load) {
-		return load_result;
-	}
+/**
+ * @var latest
+ * Most recently loaded snapshot, holding one reference. Read atomically;
+ * replaced under the reload lock.
+ */
+static terminfo_snapshot *latest = NULL;
 
-	attempted_load = true;
+/**
+ * @var acquiring
+ * Threads between reading @ref latest and referencing it. A replaced
+ * snapshot keeps its reference until there are none.
+ */
+static uint32_t acquiring = 0;
 
-	const char *env_term = getenv("TERM");
+/**
+ * @var pinned
+ * Whether the bundled xterm tables are used in place of $TERM.
+ */
+static bool pinned = false;
+
+static terminfo_snapshot *acquire_latest(void);
+static terminfo_snapshot *reload(const char *term, bool bundled);
+static terminfo_snapshot *load(const char *term, bool bundled);
+static bool is_current(const terminfo_snapshot *terminal,
+					   const char *term,
+					   bool bundled);
+static void release(terminfo_snapshot *terminal);
+static int find_entry(const char *term, char **path);
+static int try_open(const char *db_path, const char *term, char **path);
+static bool map_entry(int fd, terminfo_snapshot *terminal);
+static bool parse(terminfo_snapshot *terminal);
+static bool parse_extended(terminfo_snapshot *terminal,
+						   size_t start,
+						   uint32_t number_size);
+static bool name_equals(terminfo_seq name, const char *wanted);
+static int16_t read_int16(const uint8_t *data);
+static terminfo_seq table_lookup(const uint8_t *table,
+								 uint32_t table_size,
+								 int16_t offset);
+static terminfo_seq strip_padding(terminfo_seq seq);
+
+const terminfo_snapshot *nrl_terminfo_acquire(void) {
+	bool bundled = __atomic_load_n(&pinned, __ATOMIC_ACQUIRE);
+	const char *env_term = bundled ? "xterm" : getenv("TERM");
 	if (env_term == NULL) {
 		// TODO: warning
-		return false;
+		return NULL;
 	}
 
-#if FASTLOAD == 1
-	if (strstr(env_term, "xterm")) {
-		nrl_fl_xterm((char **)&inputs, (char **)&outputs);
+	terminfo_snapshot *terminal = acquire_latest();
+	if (terminal != NULL && is_current(terminal, env_term, bundled)) {
+		return terminal;
+	}
+	if (terminal != NULL) {
+		release(terminal);
 	}
-#endif // FASTLOAD
 
-	FILE *terminfo = find_entry(env_term);
-	if (terminfo == NULL) {
-		return false;
+	// Terminal changed or nothing is loaded yet
+	pthread_mutex_lock(&reload_lock);
+	terminal = reload(env_term, bundled);
+	pthread_mutex_unlock(&reload_lock);
+
+	return terminal;
+}
+
+void nrl_terminfo_release(const terminfo_snapshot *terminal) {
+	if (terminal != NULL) {
+		release((terminfo_snapshot *)terminal);
 	}
+}
 
-	load_result = parse(terminfo);
-	return load_result;
+bool nrl_terminfo_pin(bool pin) {
+#if FASTLOAD == 1
+	__atomic_store_n(&pinned, pin, __ATOMIC_RELEASE);
+	return true;
+#else
+	(void)pin;
+	return false;
+#endif // FASTLOAD
 }
 
-const char *nrl_lookup_input(terminfo_input id) {
-	return inputs[id];
+terminfo_seq nrl_lookup_input(const terminfo_snapshot *terminal,
+							  terminfo_input id) {
+	return terminal->inputs[id];
 }
 
-const char *nrl_lookup_output(terminfo_output id) {
-	return outputs[id];
+terminfo_seq nrl_lookup_output(const terminfo_snapshot *terminal,
+							   terminfo_output id) {
+	return terminal->outputs[id];
 }
 
 /** Static */
 
+/**
+ * @brief Reference the latest snapshot.
+ *
+ * @return Referenced snapshot; NULL if nothing is loaded.
+ */
+static terminfo_snapshot *acquire_latest(void) {
+	// Replaced snapshots are not released while this is nonzero
+	__atomic_add_fetch(&acquiring, 1, __ATOMIC_SEQ_CST);
+
+	terminfo_snapshot *terminal = __atomic_load_n(&latest, __ATOMIC_SEQ_CST);
+	if (terminal != NULL) {
+		__atomic_add_fetch(&terminal->refs, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_sub_fetch(&acquiring, 1, __ATOMIC_RELEASE);
+	return terminal;
+}
+
+/**
+ * @brief Replace the latest snapshot, unless another thread already did.
+ *
+ * @param[in] term - Terminal name.
+ * @param[in] bundled - Whether to use the bundled tables.
+ * @return Referenced snapshot; NULL if loading failed.
+ * @note Reload lock must be held.
+ */
+static terminfo_snapshot *reload(const char *term, bool bundled) {
+	terminfo_snapshot *old = latest;
+	if (old != NULL && is_current(old, term, bundled)) {
+		__atomic_add_fetch(&old->refs, 1, __ATOMIC_RELAXED);
+		return old;
+	}
+
+	terminfo_snapshot *loaded = load(term, bundled);
+	if (loaded == NULL) {
+		return NULL;
+	}
+
+	// Reference for the caller, before others can release the latest one
+	loaded->refs++;
+	__atomic_store_n(&latest, loaded, __ATOMIC_SEQ_CST);
+
+	// Threads that read the old pointer have to reference it first
+	if (old != NULL) {
+		while (__atomic_load_n(&acquiring, __ATOMIC_SEQ_CST) != 0) {
+			sched_yield();
+		}
+		release(old);
+	}
+
+	return loaded;
+}
+
+/**
+ * @brief Load a new snapshot.
+ *
+ * @param[in] term - Terminal name.
+ * @param[in] bundled - Whether to use the bundled tables only.
+ * @return Snapshot with one reference; NULL on failure.
+ */
+static terminfo_snapshot *load(const char *term, bool bundled) {
+	terminfo_snapshot *terminal = calloc(1, sizeof(terminfo_snapshot));
+	if (terminal == NULL) {
+		return NULL;
+	}
+	terminal->refs = 1;
+
+	terminal->term = strdup(term);
+	if (terminal->term == NULL) {
+		release(terminal);
+		return NULL;
+	}
+
+#if FASTLOAD == 1
+	if (strstr(term, "xterm")) {
+		nrl_fl_xterm(terminal->inputs, terminal->outputs);
+	}
+#endif // FASTLOAD
+
+	// Bundled tables are used as they are
+	if (!bundled) {
+		int entry = find_entry(term, &terminal->entry_path);
+		if (entry < 0 || !map_entry(entry, terminal) || !parse(terminal)) {
+			release(terminal);
+			return NULL;
+		}
+	}
+
+	terminal->dfa = nrl_dfa_build(terminal->inputs);
+	if (terminal->dfa == NULL) {
+		release(terminal);
+		return NULL;
+	}
+
+	return terminal;
+}
+
+/**
+ * @brief Check if a snapshot still describes the terminal.
+ *
+ * @param[in] terminal - Snapshot.
+ * @param[in] term - Current terminal name.
+ * @param[in] bundled - Whether the bundled tables are wanted.
+ * @return Whether the name and the entry file are unchanged.
+ */
+static bool is_current(const terminfo_snapshot *terminal,
+					   const char *term,
+					   bool bundled) {
+	if (strcmp(terminal->term, term) != 0) {
+		return false;
+	}
+
+	// Only bundled snapshots have no entry file
+	if ((terminal->entry_path == NULL) != bundled) {
+		return false;
+	}
+	if (bundled) {
+		return true;
+	}
+
+	struct stat info;
+	if (stat(terminal->entry_path, &info) < 0) {
+		return false;
+	}
+
+	const struct stat *loaded = &terminal->entry_info;
+	return info.st_dev == loaded->st_dev && info.st_ino == loaded->st_ino
+		&& info.st_size == loaded->st_size
+		&& info.st_mtime == loaded->st_mtime;
+}
+
+/**
+ * @brief Drop a reference, freeing the snapshot with the last one.
+ *
+ * @param[in,out] terminal - Snapshot.
+ */
+static void release(terminfo_snapshot *terminal) {
+	if (__atomic_sub_fetch(&terminal->refs, 1, __ATOMIC_ACQ_REL) > 0) {
+		return;
+	}
+
+	nrl_dfa_free(terminal->dfa);
+	if (terminal->entry_map != NULL) {
+		munmap((void *)terminal->entry_map, terminal->entry_size);
+	}
+	free(terminal->entry_path);
+	free(terminal->term);
+	free(terminal);
+}
+
 /**
  * @brief Find the terminfo entry for the given terminal.
  *
  * @param[in] term - Terminal name.
- * @return Open file or NULL (if does not exist).
+ * @param[out] path - Allocated path of the entry.
+ * @return Open file descriptor or -1 (if does not exist).
  */
-static FILE *find_entry(const char *term) {
+static int find_entry(const char *term, char **path) {
 	// $TERMINFO
 	const char *env_terminfo = getenv("TERMINFO");
 	if (env_terminfo != NULL) {
-		FILE *entry = try_open(env_terminfo, term);
-		if (entry != NULL) {
+		int entry = try_open(env_terminfo, term, path);
+		if (entry >= 0) {
 			return entry;
 		}
 	}
@@ -158,8 +417,8 @@ static FILE *find_entry(const char *term) {
 		char db_path[db_path_len];
 		sprintf(db_path, "%s/.terminfo", env_home);
 
-		FILE *entry = try_open(db_path, term);
-		if (entry != NULL) {
+		int entry = try_open(db_path, term, path);
+		if (entry >= 0) {
 			return entry;
 		}
 	}
@@ -172,8 +431,8 @@ static FILE *find_entry(const char *term) {
 		// Directories are colon-separated
 		char *dir = strtok(copy, ":");
 		while (dir != NULL) {
-			FILE *entry = try_open(dir, term);
-			if (entry != NULL) {
+			int entry = try_open(dir, term, path);
+			if (entry >= 0) {
 				free(copy);
 				return entry;
 			}
@@ -188,13 +447,13 @@ static FILE *find_entry(const char *term) {
 	const char **sysdb_trav = sysdb_path;
 	const char *sysdb;
 	while ((sysdb = *sysdb_trav++) != NULL) {
-		FILE *entry = try_open(sysdb, term);
-		if (entry != NULL) {
+		int entry = try_open(sysdb, term, path);
+		if (entry >= 0) {
 			return entry;
 		}
 	}
 
-	return NULL;
+	return -1;
 }
 
 /**
@@ -202,29 +461,77 @@ static FILE *find_entry(const char *term) {
  *
  * @param[in] db_path - Path to database.
  * @param[in] term - Terminal name.
- * @return Open file or NULL (if does not exist).
+ * @param[out] path - Allocated path of the entry, if opened.
+ * @return Open file descriptor or -1 (if does not exist).
  */
-static FILE *try_open(const char *db_path, const char *term) {
+static int try_open(const char *db_path, const char *term, char **path) {
 	// Path format: TERMINFO/FIRST_LETTER/TERMINAL \0
 	uint32_t length = strlen(db_path) + 3 + strlen(term) + 1;
 	char full_path[length];
 	snprintf(full_path, length, "%s/%c/%s", db_path, term[0], term);
 
-	return fopen(full_path, "r");
+	int entry = open(full_path, O_RDONLY);
+	if (entry < 0) {
+		return -1;
+	}
+
+	*path = strdup(full_path);
+	if (*path == NULL) {
+		close(entry);
+		return -1;
+	}
+
+	return entry;
+}
+
+/**
+ * @brief Map terminfo entry into memory.
+ *
+ * @param[in] fd - Entry file descriptor; closed by this function.
+ * @param[out] terminal - Snapshot to store the mapping in.
+ * @return true - Success.\n
+ *         false - Failed to map.
+ */
+static bool map_entry(int fd, terminfo_snapshot *terminal) {
+	struct stat *info = &terminal->entry_info;
+	if (fstat(fd, info) < 0 || info->st_size < HEADER_SIZE) {
+		close(fd);
+		return false;
+	}
+
+	void *map = mmap(NULL, info->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+
+	terminal->entry_map = map;
+	terminal->entry_size = info->st_size;
+	return true;
 }
 
 /**
  * @brief Parse terminfo entry.
  *
- * @param[in] terminfo - Terminfo file.
+ * @param[in,out] terminal - Snapshot with the mapped entry.
  * @return true - Success.\n
  *         false - Failed to parse.
  */
-static bool parse(FILE *terminfo) {
+static bool parse(terminfo_snapshot *terminal) {
+	const uint8_t *entry = terminal->entry_map;
+	size_t size = terminal->entry_size;
+	terminfo_seq *inputs = terminal->inputs;
+	terminfo_seq *outputs = terminal->outputs;
+
 	// Parse header
 	// Reference: 'man term'
-	uint16_t header[6];
-	fread(header, sizeof(uint16_t), 6, terminfo);
+	if (size < HEADER_SIZE) {
+		return false;
+	}
+	int16_t header[6];
+	for (uint32_t i = 0; i < 6; i++) {
+		header[i] = read_int16(entry + 2 * i);
+	}
 
 	uint32_t number_size;
 	switch (header[0]) {
@@ -238,49 +545,225 @@ static bool parse(FILE *terminfo) {
 		return false;
 	}
 
-	uint32_t string_start = header[1] + header[2];
+	for (uint32_t i = 1; i < 6; i++) {
+		if (header[i] < 0) {
+			return false;
+		}
+	}
+	uint32_t string_count = header[4];
+	uint32_t table_size = header[5];
+
+	size_t strings_start = HEADER_SIZE + header[1] + header[2];
 	// Extra padding byte
-	if (string_start & 1) {
-		string_start++;
+	if (strings_start & 1) {
+		strings_start++;
 	}
-	string_start += number_size * header[3];
+	strings_start += number_size * header[3];
 
-	// Load strings section
-	if (fseek(terminfo, string_start, SEEK_CUR) < 0) {
+	size_t table_start = strings_start + sizeof(int16_t) * string_count;
+	size_t table_end = table_start + table_size;
+	if (table_end > size) {
 		return false;
 	}
-	int16_t strings[header[4]];
-	if (fread(strings, sizeof(int16_t), header[4], terminfo) != header[4]) {
+	const uint8_t *strings = entry + strings_start;
+	const uint8_t *table = entry + table_start;
+
+	// Lookup all relevant capability
+	for (uint32_t i = 0; i < TII_STANDARD_COUNT; i++) {
+		int16_t offset = (input_seq_indices[i] < string_count)
+			? read_int16(strings + 2 * input_seq_indices[i])
+			: -1;
+		inputs[i] = table_lookup(table, table_size, offset);
+	}
+	for (uint32_t i = 0; i < TIO_STANDARD_COUNT; i++) {
+		int16_t offset = (output_seq_indices[i] < string_count)
+			? read_int16(strings + 2 * output_seq_indices[i])
+			: -1;
+		outputs[i] = strip_padding(table_lookup(table, table_size, offset));
+	}
+
+	for (uint32_t i = TII_STANDARD_COUNT; i < TII_COUNT; i++) {
+		inputs[i].data = NULL;
+		inputs[i].length = 0;
+	}
+	for (uint32_t i = TIO_STANDARD_COUNT; i < TIO_COUNT; i++) {
+		outputs[i].data = NULL;
+		outputs[i].length = 0;
+	}
+
+	// Extended section starts on an even byte
+	parse_extended(terminal, table_end + (table_end & 1), number_size);
+
+	return true;
+}
+
+/**
+ * @brief Parse extended (user-defined) capabilities of terminfo entry.
+ *
+ * @param[in,out] terminal - Snapshot with the mapped entry.
+ * @param[in] start - Offset of the extended header.
+ * @param[in] number_size - Size of numeric capabilities.
+ * @return true - Success.\n
+ *         false - Section missing or failed to parse.
+ */
+static bool parse_extended(terminfo_snapshot *terminal,
+						   size_t start,
+						   uint32_t number_size) {
+	const uint8_t *entry = terminal->entry_map;
+	size_t size = terminal->entry_size;
+
+	// Parse extended header
+	// Reference: 'man term'
+	if (start + EXT_HEADER_SIZE > size) {
 		return false;
 	}
+	int16_t header[5];
+	for (uint32_t i = 0; i < 5; i++) {
+		header[i] = read_int16(entry + start + 2 * i);
+		if (header[i] < 0) {
+			return false;
+		}
+	}
 
-	// Load strings table
-	char strings_table[header[5]];
-	if (fread(strings_table, sizeof(char), header[5], terminfo) != header[5]) {
+	uint32_t bool_count = header[0];
+	uint32_t number_count = header[1];
+	uint32_t string_count = header[2];
+	uint32_t name_count = bool_count + number_count + string_count;
+	uint32_t table_size = header[4];
+
+	// Skip booleans and numbers
+	size_t strings_start = start + EXT_HEADER_SIZE + bool_count
+		+ (bool_count & 1) + number_size * number_count;
+	size_t names_start = strings_start + sizeof(int16_t) * string_count;
+	size_t table_start = names_start + sizeof(int16_t) * name_count;
+	if (table_start + table_size > size) {
 		return false;
 	}
+	const uint8_t *strings = entry + strings_start;
+	const uint8_t *names = entry + names_start;
+	const uint8_t *table = entry + table_start;
+
+	// Names are stored after the last string value
+	uint32_t names_offset = 0;
+	for (uint32_t i = 0; i < string_count; i++) {
+		terminfo_seq value
+			= table_lookup(table, table_size, read_int16(strings + 2 * i));
+		if (value.data == NULL) {
+			continue;
+		}
 
-	// Lookup all relevant capability
-	for (uint32_t i = 0; i < TII_COUNT; i++) {
-		int16_t offset = strings[input_seq_indices[i]];
-		char *sequence = (offset < 0) ? NULL : (strings_table + offset);
-
-		if (sequence == NULL || strlen(sequence) == 0) {
-			inputs[i] = NULL;
-		} else {
-			inputs[i] = strdup(sequence);
+		uint32_t end = (const uint8_t *)value.data - table + value.length + 1;
+		if (end > names_offset) {
+			names_offset = end;
 		}
 	}
-	for (uint32_t i = 0; i < TIO_COUNT; i++) {
-		int16_t offset = strings[output_seq_indices[i]];
-		char *sequence = (offset < 0) ? NULL : (strings_table + offset);
+	if (names_offset >= table_size) {
+		return false;
+	}
+
+	// Lookup all relevant capabilities by name
+	for (uint32_t i = 0; i < string_count; i++) {
+		int16_t name_offset
+			= read_int16(names + 2 * (bool_count + number_count + i));
+		if (name_offset < 0) {
+			continue;
+		}
 
-		if (sequence == NULL || strlen(sequence) == 0) {
-			outputs[i] = NULL;
-		} else {
-			outputs[i] = strdup(sequence);
+		terminfo_seq name = table_lookup(table + names_offset,
+										 table_size - names_offset,
+										 name_offset);
+		if (name.data == NULL) {
+			continue;
+		}
+
+		terminfo_seq value
+			= table_lookup(table, table_size, read_int16(strings + 2 * i));
+		for (uint32_t j = TII_STANDARD_COUNT; j < TII_COUNT; j++) {
+			if (name_equals(name, input_ext_names[j - TII_STANDARD_COUNT])) {
+				terminal->inputs[j] = value;
+				break;
+			}
+		}
+		for (uint32_t j = TIO_STANDARD_COUNT; j < TIO_COUNT; j++) {
+			if (name_equals(name, output_ext_names[j - TIO_STANDARD_COUNT])) {
+				terminal->outputs[j] = value;
+				break;
+			}
 		}
 	}
 
 	return true;
 }
+
+/**
+ * @brief Compare capability name.
+ *
+ * @param[in] name - Name from the entry.
+ * @param[in] wanted - Expected name.
+ * @return Whether names are equal.
+ */
+static bool name_equals(terminfo_seq name, const char *wanted) {
+	return strlen(wanted) == name.length
+		&& memcmp(name.data, wanted, name.length) == 0;
+}
+
+/**
+ * @brief Read little-endian 16-bit integer.
+ *
+ * @param[in] data - Integer location.
+ * @return Integer value.
+ */
+static int16_t read_int16(const uint8_t *data) {
+	return (int16_t)(data[0] | (data[1] << 8));
+}
+
+/**
+ * @brief Get string from a string table.
+ *
+ * @param[in] table - String table.
+ * @param[in] table_size - String table size.
+ * @param[in] offset - Offset of the string.
+ * @return View of the string; NULL data if missing, empty or out of bounds.
+ */
+static terminfo_seq table_lookup(const uint8_t *table,
+								 uint32_t table_size,
+								 int16_t offset) {
+	terminfo_seq seq = { NULL, 0 };
+	if (offset < 0 || (uint32_t)offset >= table_size) {
+		return seq;
+	}
+
+	// String must be terminated inside the table
+	const uint8_t *end
+		= memchr(table + offset, '\0', table_size - (uint32_t)offset);
+	if (end == NULL || end == table + offset) {
+		return seq;
+	}
+
+	seq.data = (const char *)(table + offset);
+	seq.length = end - (table + offset);
+	return seq;
+}
+
+/**
+ * @brief Remove a trailing padding delay (e.g. "$<50>") from an output string.
+ *
+ * @param[in] seq - Output string.
+ * @return String without the delay.
+ * @note Delays elsewhere in the string are kept.
+ */
+static terminfo_seq strip_padding(terminfo_seq seq) {
+	if (seq.length < 3 || seq.data[seq.length - 1] != '>') {
+		return seq;
+	}
+
+	uint32_t start = seq.length - 1;
+	while (start > 0 && seq.data[start] != '<') {
+		start--;
+	}
+
+	if (start > 0 && seq.data[start - 1] == '$') {
+		seq.length = start - 1;
+	}
+	return seq;
+}
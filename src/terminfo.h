@@ -10,10 +10,16 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+struct dfa_node;
 
 /**
  * @enum terminfo_input
  * Internal identifiers for terminfo input sequences.
+ * @note Order is mirrored by @ref nrl_key.
  */
 typedef enum {
 	TII_KEY_LEFT,
@@ -22,13 +28,28 @@ typedef enum {
 	TII_KEY_HOME,
 	TII_KEY_END,
 	TII_KEY_DELETE,
+
+	// Extended capabilities
+	TII_KEY_CTRL_LEFT,
+	TII_KEY_CTRL_RIGHT,
+	TII_KEY_ALT_LEFT,
+	TII_KEY_ALT_RIGHT,
+	TII_KEY_CTRL_DELETE,
+	TII_PASTE_START,
+	TII_PASTE_END,
 } terminfo_input;
 
+/**
+ * @def TII_STANDARD_COUNT
+ * Entries in @ref terminfo_input from the standard capabilities.
+ */
+#define TII_STANDARD_COUNT 6
+
 /**
  * @def TII_COUNT
  * Total entries in @ref terminfo_input
  */
-#define TII_COUNT 6
+#define TII_COUNT 13
 
 /**
  * @enum terminfo_output
@@ -37,40 +58,145 @@ typedef enum {
 typedef enum {
 	TIO_CURSOR_LEFT,
 	TIO_CURSOR_RIGHT,
+	TIO_CURSOR_UP,
+	TIO_CURSOR_DOWN,
 	TIO_KEYPAD_LOCAL,
 	TIO_KEYPAD_XMIT,
+	TIO_CLEAR_EOS,
+	TIO_PARM_LEFT,
+	TIO_PARM_RIGHT,
+	TIO_PARM_UP,
+	TIO_PARM_DOWN,
+
+	// Extended capabilities
+	TIO_PASTE_ON,
+	TIO_PASTE_OFF,
 } terminfo_output;
 
+/**
+ * @def TIO_STANDARD_COUNT
+ * Entries in @ref terminfo_output from the standard capabilities.
+ */
+#define TIO_STANDARD_COUNT 11
+
 /**
  * @def TIO_COUNT
  * Total entries in @ref terminfo_output
  */
-#define TIO_COUNT 4
+#define TIO_COUNT 13
+
+/**
+ * @struct terminfo_seq
+ * View of an escape sequence.
+ *
+ * @var terminfo_seq::data
+ * Sequence data; NULL if not supported. Not null-terminated.
+ *
+ * @var terminfo_seq::length
+ * Sequence length.
+ */
+typedef struct {
+	const char *data;
+	uint32_t length;
+} terminfo_seq;
+
+/**
+ * @struct terminfo_snapshot
+ * Capabilities of a terminal and the DFA compiled from them. Immutable once
+ * published, so it can be shared between threads while referenced.
+ *
+ * @var terminfo_snapshot::inputs
+ * Input sequences.
+ *
+ * @var terminfo_snapshot::outputs
+ * Output sequences.
+ *
+ * @var terminfo_snapshot::dfa
+ * Escape sequence DFA for the inputs.
+ *
+ * @var terminfo_snapshot::term
+ * Terminal name the snapshot was loaded for.
+ *
+ * @var terminfo_snapshot::entry_path
+ * Path of the source entry; NULL for the bundled tables.
+ *
+ * @var terminfo_snapshot::entry_info
+ * Source entry status at load time, to detect changes.
+ *
+ * @var terminfo_snapshot::entry_map
+ * Read-only mapping of the entry. Sequences point into it.
+ *
+ * @var terminfo_snapshot::entry_size
+ * Size of the mapping.
+ *
+ * @var terminfo_snapshot::refs
+ * Reference count, updated atomically.
+ */
+typedef struct {
+	terminfo_seq inputs[TII_COUNT];
+	terminfo_seq outputs[TIO_COUNT];
+	struct dfa_node *dfa;
+
+	char *term;
+	char *entry_path;
+	struct stat entry_info;
+	const uint8_t *entry_map;
+	size_t entry_size;
+
+	uint32_t refs;
+} terminfo_snapshot;
 
 /**
- * @brief Find and load terminfo data for the user's terminal.
+ * @brief Get capabilities for the user's terminal.
+ *
+ * The last snapshot is shared if $TERM and its entry file are unchanged;
+ * otherwise a new one is loaded and replaces it. See @ref nrl_terminfo_pin.
+ *
+ * @return Referenced snapshot; NULL if loading failed.
+ * @note Thread-safe; lock-free while the latest snapshot is current. Release
+ * with @ref nrl_terminfo_release.
+ */
+const terminfo_snapshot *nrl_terminfo_acquire(void);
+
+/**
+ * @brief Drop a reference to a snapshot.
+ *
+ * @param[in] terminal - Snapshot from @ref nrl_terminfo_acquire (can be
+ * NULL).
+ * @note Thread-safe.
+ */
+void nrl_terminfo_release(const terminfo_snapshot *terminal);
+
+/**
+ * @brief Use the bundled xterm tables in place of the user's terminal.
+ *
+ * While pinned, $TERM and the terminfo database are not consulted, so output
+ * does not depend on the host.
  *
- * @return true - Success.\n
- *         false - Failed to load.
+ * @param[in] pin - Whether to pin or unpin.
+ * @return Whether the tables are bundled (FASTLOAD builds).
+ * @note Thread-safe. Snapshots acquired before the change stay valid.
  */
-bool nrl_load_terminfo(void);
+bool nrl_terminfo_pin(bool pin);
 
 /**
  * @brief Get ASCII string for input escape sequence.
  *
+ * @param[in] terminal - Terminal capabilities.
  * @param[in] id - Interal identifier.
- * @return ASCII representation, null-terminated string.
- * @note Should only be called after nrl_load_terminfo.
+ * @return ASCII representation.
  */
-const char *nrl_lookup_input(terminfo_input id);
+terminfo_seq nrl_lookup_input(const terminfo_snapshot *terminal,
+							  terminfo_input id);
 
 /**
  * @brief Get ASCII string for output escape sequence.
  *
+ * @param[in] terminal - Terminal capabilities.
  * @param[in] id - Interal identifier.
- * @return ASCII representation, null-terminated string.
- * @note Should only be called after nrl_load_terminfo.
+ * @return ASCII representation.
  */
-const char *nrl_lookup_output(terminfo_output id);
+terminfo_seq nrl_lookup_output(const terminfo_snapshot *terminal,
+							   terminfo_output id);
 
 // @endcond
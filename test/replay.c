@@ -0,0 +1,245 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nanorl/nanorl.h>
+
+/**
+ * Screen checks of scripted sessions. Each session is encoded as a
+ * recording and replayed, which needs a build with SCREEN_CHECK. No single
+ * keystroke may output more than the session's byte budget.
+ */
+
+#define CHUNK_DELAY_NS 1000000
+
+#define KEY_LEFT "\033OD"
+#define KEY_RIGHT "\033OC"
+#define KEY_HOME "\033OH"
+#define KEY_END "\033OF"
+#define KEY_BACKSPACE "\177"
+#define KEY_CTRL_LEFT "\033[1;5D"
+
+#define X10 "xxxxxxxxxx"
+#define X50 X10 X10 X10 X10 X10
+
+#define SUGGESTION "hello world"
+
+/**
+ * Output bytes allowed for a keystroke that moves the cursor or appends.
+ */
+#define KEY_BUDGET 16
+
+/**
+ * Terminal width in replays; scroll mode redraws at most this much.
+ */
+#define COLUMNS 80
+
+typedef struct {
+	const char *name;
+	nrl_layout_mode layout_mode;
+	nrl_echo_mode echo_mode;
+	bool suggest;
+	uint64_t lines;
+	uint64_t budget;
+	const char *chunks[16];
+} session;
+
+static const session sessions[] = {
+	{
+		.name = "wrap across rows",
+		.echo_mode = NRL_ECHO_ON,
+		.lines = 1,
+		.budget = 100 + KEY_BUDGET,
+		.chunks = { X50 X50, KEY_HOME, "Y", KEY_END, "Z", KEY_LEFT, KEY_LEFT,
+					KEY_BACKSPACE, KEY_CTRL_LEFT, "\n" },
+	},
+	{
+		.name = "wrap shrinking",
+		.echo_mode = NRL_ECHO_ON,
+		.lines = 1,
+		.budget = 100 + KEY_BUDGET,
+		.chunks = { "word " X50 X50, KEY_BACKSPACE KEY_BACKSPACE KEY_BACKSPACE,
+					"\x17", "\n" },
+	},
+	{
+		.name = "wrap at the last column",
+		.echo_mode = NRL_ECHO_ON,
+		.lines = 2,
+		.budget = KEY_BUDGET,
+		.chunks = { X50 X10 X10 "xxxxxxxx", KEY_LEFT, KEY_RIGHT, "y",
+					KEY_BACKSPACE, "\n", X50 X50 X50 X10 "xxxxxxxx",
+					KEY_HOME, KEY_END, "\n" },
+	},
+	{
+		.name = "cursor moves",
+		.echo_mode = NRL_ECHO_ON,
+		.lines = 1,
+		.budget = KEY_BUDGET,
+		.chunks = { "some words", KEY_LEFT, KEY_CTRL_LEFT, KEY_HOME,
+					KEY_RIGHT, KEY_END, "\n" },
+	},
+	{
+		.name = "cursor moves across rows",
+		.echo_mode = NRL_ECHO_ON,
+		.lines = 1,
+		.budget = KEY_BUDGET,
+		.chunks = { X50 X50 X50 " end", KEY_HOME, KEY_END, KEY_CTRL_LEFT,
+					KEY_HOME, KEY_RIGHT, KEY_END, "\n" },
+	},
+	{
+		.name = "scroll",
+		.echo_mode = NRL_ECHO_ON,
+		.layout_mode = NRL_LAYOUT_SCROLL,
+		.lines = 1,
+		.budget = COLUMNS + KEY_BUDGET,
+		.chunks = { X50 X50 X50, KEY_HOME, "Y", KEY_END, KEY_BACKSPACE,
+					"\n" },
+	},
+	{
+		.name = "obscured",
+		.echo_mode = NRL_ECHO_OBSCURED,
+		.lines = 1,
+		.budget = KEY_BUDGET,
+		.chunks = { "secret", KEY_LEFT, KEY_LEFT, KEY_BACKSPACE, "\n" },
+	},
+	{
+		.name = "suggestion",
+		.echo_mode = NRL_ECHO_ON,
+		.suggest = true,
+		.lines = 1,
+		.budget = sizeof(SUGGESTION) + KEY_BUDGET,
+		.chunks = { "he", "l", KEY_BACKSPACE, KEY_RIGHT, "\n" },
+	},
+	{
+		.name = "paste",
+		.echo_mode = NRL_ECHO_ON,
+		.lines = 1,
+		.budget = 100 + KEY_BUDGET,
+		.chunks = { "ab", "\033[200~" X50 X50 "\033[201~", KEY_HOME, "\n" },
+	},
+};
+
+static bool run(const session *test);
+static bool write_recording(FILE *file, const char *const *chunks);
+static bool write_chunk(FILE *file, const char *data, size_t length);
+static bool write_varint(FILE *file, uint64_t value);
+
+int main(void) {
+	nrl_history_add(SUGGESTION);
+
+	uint32_t failed = 0;
+	uint32_t count = sizeof(sessions) / sizeof(sessions[0]);
+	for (uint32_t i = 0; i < count; i++) {
+		if (!run(&sessions[i])) {
+			failed++;
+		}
+	}
+
+	printf("replay: %u/%u passed\n", count - failed, count);
+	return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Replay a session and check the report.
+ *
+ * @param[in] test - Session.
+ * @return Whether the session passed.
+ */
+static bool run(const session *test) {
+	FILE *file = tmpfile();
+	if (file == NULL || !write_recording(file, test->chunks)) {
+		printf("%s: failed to write recording\n", test->name);
+		return false;
+	}
+
+	nrl_config config = nrl_default_config();
+	config.prompt = "> ";
+	config.layout_mode = test->layout_mode;
+	config.echo_mode = test->echo_mode;
+	config.suggest = test->suggest;
+
+	nrl_replay_report report;
+	nrl_error error = nrl_replay(fileno(file), &config, &report);
+	fclose(file);
+
+	bool passed = error == NRL_ERROR_OK && report.lines == test->lines
+		&& report.screen_mismatches == 0
+		&& report.render_bytes_max <= test->budget;
+	if (!passed) {
+		printf("%s: error %d, %lu/%lu lines, %lu mismatches, %lu/%lu bytes\n",
+			   test->name, error, (unsigned long)report.lines,
+			   (unsigned long)test->lines,
+			   (unsigned long)report.screen_mismatches,
+			   (unsigned long)report.render_bytes_max,
+			   (unsigned long)test->budget);
+	}
+
+	return passed;
+}
+
+/**
+ * @brief Encode chunks as a recording.
+ *
+ * @param[in,out] file - File to write to; rewound for reading.
+ * @param[in] chunks - NULL-terminated chunk list.
+ * @return Whether write succeeded.
+ * @note Chunks other than escape sequences are typed one byte at a time, so
+ * each render follows a single keystroke.
+ */
+static bool write_recording(FILE *file, const char *const *chunks) {
+	if (fwrite("NRLR\001", 1, 5, file) != 5) {
+		return false;
+	}
+
+	for (; *chunks != NULL; chunks++) {
+		size_t length = strlen(*chunks);
+		if ((*chunks)[0] == '\033') {
+			if (!write_chunk(file, *chunks, length)) {
+				return false;
+			}
+			continue;
+		}
+
+		for (size_t i = 0; i < length; i++) {
+			if (!write_chunk(file, *chunks + i, 1)) {
+				return false;
+			}
+		}
+	}
+
+	return fflush(file) == 0 && fseek(file, 0, SEEK_SET) == 0;
+}
+
+/**
+ * @brief Encode a single chunk.
+ *
+ * @param[in,out] file - File to write to.
+ * @param[in] data - Chunk data.
+ * @param[in] length - Chunk length.
+ * @return Whether write succeeded.
+ */
+static bool write_chunk(FILE *file, const char *data, size_t length) {
+	return write_varint(file, CHUNK_DELAY_NS) && write_varint(file, length)
+		&& fwrite(data, 1, length, file) == length;
+}
+
+/**
+ * @brief Write an integer as LEB128.
+ *
+ * @param[in,out] file - File to write to.
+ * @param[in] value - Value to encode.
+ * @return Whether write succeeded.
+ */
+static bool write_varint(FILE *file, uint64_t value) {
+	while (value >= 0x80) {
+		if (fputc((int)(value | 0x80) & 0xff, file) == EOF) {
+			return false;
+		}
+		value >>= 7;
+	}
+
+	return fputc((int)value, file) != EOF;
+}
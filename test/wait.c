@@ -0,0 +1,432 @@
+#define _XOPEN_SOURCE 700
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <nanorl/nanorl.h>
+
+/**
+ * Checks of the input wait on a pseudo-terminal: cancellation, timeouts and
+ * async messages, alone and racing input.
+ */
+
+#define RACE_ROUNDS 200
+#define RACE_STEP_NS 50000
+#define RACE_STEPS 20
+#define RETRY_TIMEOUT_MS 1000
+
+/**
+ * Action of the helper thread, started together with a nanorl call.
+ */
+typedef struct {
+	uint64_t delay_ns;
+	const char *message;
+	const char *input;
+	bool cancel;
+	bool cancel_first;
+} action;
+
+typedef struct {
+	const char *name;
+	bool (*run)(void);
+} check;
+
+static bool check_input(void);
+static bool check_timeout(void);
+static bool check_cancel(void);
+static bool check_notify(void);
+static bool check_cancel_race(void);
+static bool check_timeout_race(void);
+static bool check_notify_race(void);
+
+static const check checks[] = {
+	{ "input", &check_input },
+	{ "timeout", &check_timeout },
+	{ "cancel", &check_cancel },
+	{ "notify", &check_notify },
+	{ "cancel racing input", &check_cancel_race },
+	{ "timeout racing input", &check_timeout_race },
+	{ "notify racing input", &check_notify_race },
+};
+
+static int master = -1;
+static int slave = -1;
+static nrl_cancel *cancel = NULL;
+
+/**
+ * Terminal output since the last check.
+ */
+static char output[1 << 16];
+static size_t output_size = 0;
+
+static bool open_terminal(void);
+static char *read_line(const action *act,
+					   uint32_t timeout_ms,
+					   bool cancellable,
+					   nrl_error *error);
+static bool expect_line(const action *act,
+						uint32_t timeout_ms,
+						bool cancellable,
+						const char *line);
+static void *run_action(void *arg);
+static void drain_output(void);
+static void sleep_ns(uint64_t ns);
+
+int main(void) {
+	// Bundled terminal description, regardless of the host
+	setenv("TERM", "xterm", 1);
+
+	cancel = nrl_cancel_create();
+	if (cancel == NULL || !open_terminal()) {
+		printf("wait: failed to set up\n");
+		return EXIT_FAILURE;
+	}
+
+	// Raw mode stays on between calls, so input typed early is not handled
+	// by the line discipline
+	nrl_config config = nrl_default_config();
+	config.read_file = slave;
+	config.echo_file = slave;
+	if (nrl_session_begin(&config) != NRL_ERROR_OK) {
+		printf("wait: failed to set up\n");
+		return EXIT_FAILURE;
+	}
+
+	uint32_t failed = 0;
+	uint32_t count = sizeof(checks) / sizeof(checks[0]);
+	for (uint32_t i = 0; i < count; i++) {
+		if (!checks[i].run()) {
+			printf("%s: failed\n", checks[i].name);
+			failed++;
+		}
+	}
+
+	nrl_session_end();
+	drain_output();
+
+	printf("wait: %u/%u passed\n", count - failed, count);
+	return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Check that input is read without stops.
+ *
+ * @return Whether the check passed.
+ */
+static bool check_input(void) {
+	action act = { .input = "first\n" };
+	return expect_line(&act, 0, false, "first");
+}
+
+/**
+ * @brief Check that a timeout stops the call and keeps later input.
+ *
+ * @return Whether the check passed.
+ */
+static bool check_timeout(void) {
+	nrl_error error;
+	char *line = read_line(NULL, 20, false, &error);
+	free(line);
+	if (error != NRL_ERROR_TIMEOUT) {
+		return false;
+	}
+
+	action act = { .delay_ns = 10000000, .input = "after timeout\n" };
+	return expect_line(&act, 0, false, "after timeout");
+}
+
+/**
+ * @brief Check that cancellation stops a waiting call.
+ *
+ * @return Whether the check passed.
+ */
+static bool check_cancel(void) {
+	action act = { .delay_ns = 10000000, .cancel = true };
+	nrl_error error;
+	char *line = read_line(&act, 0, true, &error);
+	free(line);
+	nrl_cancel_reset(cancel);
+	if (error != NRL_ERROR_CANCEL) {
+		return false;
+	}
+
+	act = (action){ .delay_ns = 10000000, .input = "after cancel\n" };
+	return expect_line(&act, 0, true, "after cancel");
+}
+
+/**
+ * @brief Check that messages are printed while waiting, and the wait goes on.
+ *
+ * @return Whether the check passed.
+ */
+static bool check_notify(void) {
+	action act = { .delay_ns = 10000000, .message = "notified" };
+	nrl_error error;
+	char *line = read_line(&act, 100, false, &error);
+	free(line);
+	if (error != NRL_ERROR_TIMEOUT || strstr(output, "notified") == NULL) {
+		return false;
+	}
+
+	act = (action){ .delay_ns = 10000000, .input = "after notify\n" };
+	return expect_line(&act, 0, false, "after notify");
+}
+
+/**
+ * @brief Trigger cancellation right before or after input arrives; the line
+ * must be returned either by the cancelled call or by the next one.
+ *
+ * @return Whether the check passed.
+ */
+static bool check_cancel_race(void) {
+	for (uint32_t i = 0; i < RACE_ROUNDS; i++) {
+		char input[32];
+		sprintf(input, "cancel %u\n", i);
+		action act = {
+			.delay_ns = (i % RACE_STEPS) * RACE_STEP_NS,
+			.input = input,
+			.cancel = true,
+			.cancel_first = i % 2 == 0,
+		};
+
+		nrl_error error;
+		char *line = read_line(&act, 0, true, &error);
+		nrl_cancel_reset(cancel);
+
+		input[strlen(input) - 1] = '\0';
+		bool passed = (error == NRL_ERROR_OK) ? strcmp(line, input) == 0
+			: error == NRL_ERROR_CANCEL
+				&& expect_line(NULL, RETRY_TIMEOUT_MS, true, input);
+		free(line);
+
+		if (!passed) {
+			printf("cancel racing input: round %u\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Let input arrive around the deadline; the line must be returned
+ * either by the timed out call or by the next one.
+ *
+ * @return Whether the check passed.
+ */
+static bool check_timeout_race(void) {
+	for (uint32_t i = 0; i < RACE_ROUNDS; i++) {
+		char input[32];
+		sprintf(input, "timeout %u\n", i);
+		action act = {
+			.delay_ns = 500000 + (i % RACE_STEPS) * RACE_STEP_NS,
+			.input = input,
+		};
+
+		nrl_error error;
+		char *line = read_line(&act, 1, false, &error);
+
+		input[strlen(input) - 1] = '\0';
+		bool passed = (error == NRL_ERROR_OK) ? strcmp(line, input) == 0
+			: error == NRL_ERROR_TIMEOUT
+				&& expect_line(NULL, RETRY_TIMEOUT_MS, false, input);
+		free(line);
+
+		if (!passed) {
+			printf("timeout racing input: round %u\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Queue a message together with input; both must come through.
+ *
+ * @return Whether the check passed.
+ */
+static bool check_notify_race(void) {
+	for (uint32_t i = 0; i < RACE_ROUNDS; i++) {
+		char input[32];
+		char message[32];
+		sprintf(input, "input %u\n", i);
+		sprintf(message, "message %u", i);
+		action act = {
+			.delay_ns = (i % RACE_STEPS) * RACE_STEP_NS,
+			.message = message,
+			.input = input,
+		};
+
+		char line[32];
+		sprintf(line, "input %u", i);
+		bool passed = expect_line(&act, 0, false, line);
+
+		// Message may be printed by the next call
+		if (passed && strstr(output, message) == NULL) {
+			action next = { .input = "\n" };
+			passed = expect_line(&next, 0, false, "")
+				&& strstr(output, message) != NULL;
+		}
+
+		if (!passed) {
+			printf("notify racing input: round %u\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Open a pseudo-terminal for the calls.
+ *
+ * @return Whether the terminal was opened.
+ */
+static bool open_terminal(void) {
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+		return false;
+	}
+
+	const char *name = ptsname(master);
+	if (name == NULL) {
+		return false;
+	}
+	slave = open(name, O_RDWR | O_NOCTTY);
+	if (slave < 0) {
+		return false;
+	}
+
+	struct winsize size = { .ws_row = 24, .ws_col = 80 };
+	return ioctl(master, TIOCSWINSZ, &size) == 0
+		&& fcntl(master, F_SETFL, O_NONBLOCK) == 0;
+}
+
+/**
+ * @brief Run a nanorl call on the terminal, with an action started along.
+ *
+ * @param[in] act - Action; can be NULL.
+ * @param[in] timeout_ms - Time limit; 0 for none.
+ * @param[in] cancellable - Whether the call uses the cancellation handle.
+ * @param[out] error - Error code of the call.
+ * @return Line returned by the call.
+ * @note Terminal output of the call is left in output.
+ */
+static char *read_line(const action *act,
+					   uint32_t timeout_ms,
+					   bool cancellable,
+					   nrl_error *error) {
+	nrl_config config = nrl_default_config();
+	config.read_file = slave;
+	config.echo_file = slave;
+	config.prompt = "> ";
+	config.echo_mode = NRL_ECHO_ON;
+	config.timeout_ms = timeout_ms;
+	config.cancel = cancellable ? cancel : NULL;
+
+	output_size = 0;
+	output[0] = '\0';
+
+	pthread_t helper;
+	bool started = act != NULL
+		&& pthread_create(&helper, NULL, &run_action, (void *)act) == 0;
+
+	char *line = nanorl(&config, error);
+	if (started) {
+		pthread_join(helper, NULL);
+	}
+
+	drain_output();
+	return line;
+}
+
+/**
+ * @brief Run a nanorl call and compare the line.
+ *
+ * @param[in] act - Action; can be NULL.
+ * @param[in] timeout_ms - Time limit; 0 for none.
+ * @param[in] cancellable - Whether the call uses the cancellation handle.
+ * @param[in] line - Expected line.
+ * @return Whether the call returned the line.
+ */
+static bool expect_line(const action *act,
+						uint32_t timeout_ms,
+						bool cancellable,
+						const char *line) {
+	nrl_error error;
+	char *result = read_line(act, timeout_ms, cancellable, &error);
+	bool passed
+		= error == NRL_ERROR_OK && result != NULL && strcmp(result, line) == 0;
+	free(result);
+
+	return passed;
+}
+
+/**
+ * @brief Helper thread: wait, then queue the message, type the input and
+ * trigger cancellation, in that order. Cancellation can go first instead,
+ * with the same wait before the input.
+ *
+ * @param[in] arg - Action.
+ * @return NULL.
+ */
+static void *run_action(void *arg) {
+	const action *act = arg;
+	sleep_ns(act->delay_ns);
+
+	if (act->cancel && act->cancel_first) {
+		nrl_cancel_trigger(cancel);
+		sleep_ns(act->delay_ns);
+	}
+	if (act->message != NULL) {
+		nrl_print_async(act->message);
+	}
+	if (act->input != NULL) {
+		size_t length = strlen(act->input);
+		if (write(master, act->input, length) != (ssize_t)length) {
+			perror("write");
+		}
+	}
+	if (act->cancel && !act->cancel_first) {
+		nrl_cancel_trigger(cancel);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Read pending terminal output, so writes of the calls never block.
+ */
+static void drain_output(void) {
+	char buf[4096];
+	ssize_t bytes;
+	while ((bytes = read(master, buf, sizeof(buf))) > 0) {
+		size_t room = sizeof(output) - 1 - output_size;
+		size_t copied = ((size_t)bytes < room) ? (size_t)bytes : room;
+		memcpy(output + output_size, buf, copied);
+		output_size += copied;
+	}
+
+	output[output_size] = '\0';
+}
+
+/**
+ * @brief Sleep for a while.
+ *
+ * @param[in] ns - Time in nanoseconds.
+ */
+static void sleep_ns(uint64_t ns) {
+	struct timespec delay = {
+		.tv_sec = ns / 1000000000,
+		.tv_nsec = ns % 1000000000,
+	};
+	nanosleep(&delay, NULL);
+}